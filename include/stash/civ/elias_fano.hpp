@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+#include <stash/pred/result.hpp>
+#include <stash/vec/bit_vector.hpp>
+#include <stash/vec/bit_select.hpp>
+#include <stash/vec/int_vector.hpp>
+#include <stash/util/assert.hpp>
+#include <stash/util/likely.hpp>
+#include <stash/util/math.hpp>
+
+namespace stash {
+namespace civ {
+
+// Elias-Fano encoding of a sorted integer sequence
+//
+// each value is split into m_lo_bits low bits, which are stored in an
+// int_vector, and high bits, which are stored in a bit vector as the
+// difference to the previous value's high bits in unary
+class elias_fano {
+private:
+    size_t m_size;
+    size_t m_lo_bits;
+    uint64_t m_min;
+    uint64_t m_max;
+
+    int_vector                  m_lo;
+    std::shared_ptr<bit_vector> m_hi;
+    bit_select0                 m_sel0;
+    bit_select1                 m_sel1;
+
+    inline uint64_t hi(const uint64_t x) const {
+        return x >> m_lo_bits;
+    }
+
+    inline uint64_t lo(const uint64_t x) const {
+        return x & bit_mask(m_lo_bits);
+    }
+
+    // finds the first 1-bit in the high bits at or after pos, which must exist
+    inline size_t next_one(const size_t pos) const {
+        size_t b = pos >> 6ULL;
+        uint64_t v = m_hi->block64(b) & (UINT64_MAX << (pos & 63ULL));
+        while(!v) v = m_hi->block64(++b);
+        return (b << 6ULL) + __builtin_ctzll(v);
+    }
+
+    // finds the last 1-bit in the high bits before pos, which must exist
+    inline size_t prev_one(const size_t pos) const {
+        size_t b = pos >> 6ULL;
+        uint64_t v = m_hi->block64(b) & bit_mask(pos & 63ULL);
+        while(!v) v = m_hi->block64(--b);
+        return (b << 6ULL) + 63ULL - __builtin_clzll(v);
+    }
+
+    // decodes the i-th value given the position of its 1-bit in the high bits
+    inline uint64_t decode(const size_t i, const size_t pos) const {
+        return ((pos - i) << m_lo_bits) | m_lo[i];
+    }
+
+public:
+    inline elias_fano() : m_size(0), m_lo_bits(0), m_min(0), m_max(0) {
+    }
+
+    inline elias_fano(const elias_fano& other) {
+        *this = other;
+    }
+
+    inline elias_fano(elias_fano&& other) {
+        *this = std::move(other);
+    }
+
+    // maps a sequence written using write
+    inline elias_fano(io::mapped_reader& in) {
+        m_size = in.read();
+        m_lo_bits = in.read();
+        m_min = in.read();
+        m_max = in.read();
+        m_lo = int_vector(in);
+        m_hi = std::make_shared<bit_vector>(in);
+        m_sel0 = bit_select0(m_hi, in);
+        m_sel1 = bit_select1(m_hi, in);
+    }
+
+    template<typename array_t>
+    inline elias_fano(const array_t& array)
+        : m_size(array.size()),
+          m_min(uint64_t(array[0])),
+          m_max(uint64_t(array[m_size-1])) {
+
+        assert_sorted_ascending(array);
+
+        // the number of low bits that minimizes the total size
+        m_lo_bits = std::max(uint64_t(1), log2_floor(m_max / m_size));
+
+        // encode
+        m_lo = int_vector(m_size, m_lo_bits);
+        m_hi = std::make_shared<bit_vector>(m_size + hi(m_max) + 1);
+        {
+            auto& bits = *m_hi;
+            for(size_t i = 0; i < m_size; i++) {
+                const uint64_t x = uint64_t(array[i]);
+                m_lo[i] = lo(x);
+                bits[hi(x) + i] = 1;
+            }
+        }
+
+        // select
+        m_sel0 = bit_select0(m_hi);
+        m_sel1 = bit_select1(m_hi);
+    }
+
+    inline elias_fano& operator=(const elias_fano& other) {
+        m_size = other.m_size;
+        m_lo_bits = other.m_lo_bits;
+        m_min = other.m_min;
+        m_max = other.m_max;
+        m_lo = other.m_lo;
+        m_hi = other.m_hi;
+        m_sel0 = other.m_sel0;
+        m_sel1 = other.m_sel1;
+        return *this;
+    }
+
+    inline elias_fano& operator=(elias_fano&& other) {
+        m_size = other.m_size;
+        m_lo_bits = other.m_lo_bits;
+        m_min = other.m_min;
+        m_max = other.m_max;
+        m_lo = std::move(other.m_lo);
+        m_hi = std::move(other.m_hi);
+        m_sel0 = std::move(other.m_sel0);
+        m_sel1 = std::move(other.m_sel1);
+        return *this;
+    }
+
+    // random access
+    inline uint64_t operator[](size_t i) const {
+        assert(i < m_size);
+        return decode(i, m_sel1(i+1));
+    }
+
+    // finds the first value greater than or equal to x
+    inline pred::value_result<uint64_t> next_geq(const uint64_t x) const {
+        if(unlikely(x <= m_min)) return pred::value_result<uint64_t> { true, 0, m_min };
+        if(unlikely(x > m_max))  return pred::value_result<uint64_t> { false, 0, 0 };
+
+        // find the beginning of the bucket of values with the same high bits
+        const uint64_t h = hi(x);
+        size_t pos = h ? m_sel0(h) + 1 : 0;
+        size_t i = pos - h;
+
+        // scan the bucket - if x is greater than all of its values,
+        // the result is the first value of the next non-empty bucket
+        const uint64_t l = lo(x);
+        const auto& bits = *m_hi;
+        while(bits[pos] && m_lo[i] < l) {
+            ++pos;
+            ++i;
+        }
+        return pred::value_result<uint64_t> { true, i, decode(i, next_one(pos)) };
+    }
+
+    // finds the last value less than or equal to x
+    inline pred::value_result<uint64_t> predecessor(const uint64_t x) const {
+        if(unlikely(x < m_min))  return pred::value_result<uint64_t> { false, 0, 0 };
+        if(unlikely(x >= m_max)) return pred::value_result<uint64_t> { true, m_size-1, m_max };
+
+        // find the end of the bucket of values with the same high bits
+        const uint64_t h = hi(x);
+        size_t pos = m_sel0(h+1);
+        size_t i = pos - h;
+
+        // scan the bucket backwards - if x is less than all of its values,
+        // the result is the last value of the previous non-empty bucket
+        // (which exists because x >= m_min)
+        const uint64_t l = lo(x);
+        const auto& bits = *m_hi;
+        while(pos > 0 && bits[pos-1] && m_lo[i-1] > l) {
+            --pos;
+            --i;
+        }
+
+        assert(i > 0);
+        return pred::value_result<uint64_t> { true, i-1, decode(i-1, prev_one(pos)) };
+    }
+
+    inline pred::value_result<uint64_t> successor(const uint64_t x) const {
+        return next_geq(x);
+    }
+
+    inline size_t size() const {
+        return m_size;
+    }
+
+    // prefetches the select directory entries and low bits accessed by
+    // access to the i-th value
+    inline void prefetch(size_t i) const {
+        m_sel1.prefetch(i+1);
+        m_lo.prefetch(i);
+    }
+
+    // writes the sequence so that it can be mapped into memory later
+    inline void write(io::serializer& out) const {
+        out.write(m_size);
+        out.write(m_lo_bits);
+        out.write(m_min);
+        out.write(m_max);
+        m_lo.write(out);
+        m_hi->write(out);
+        m_sel0.write(out);
+        m_sel1.write(out);
+    }
+};
+
+}}
@@ -4,18 +4,19 @@
 #include <utility>
 
 #include <stash/vec/bit_vector.hpp>
-#include <stash/vec/bit_rank.hpp>
 #include <stash/vec/bit_select.hpp>
+#include <stash/vec/int_vector.hpp>
 #include <stash/util/assert.hpp>
 
 namespace stash {
 namespace civ {
 
+// the i-th value is the number of 1-bits before the (i+1)-th 0-bit in the unary
+// code, which is its position minus i, so access needs a single select query
 class unary_sorted_sequence {
 private:
     size_t                      m_size;
     std::shared_ptr<bit_vector> m_bits;
-    bit_rank                    m_rank;
     bit_select0                 m_sel0;
 
     template<typename T>
@@ -33,6 +34,13 @@ public:
     inline unary_sorted_sequence() : m_size(0) {
     }
 
+    // maps a sequence written using write
+    inline unary_sorted_sequence(io::mapped_reader& in) {
+        m_size = in.read();
+        m_bits = std::make_shared<bit_vector>(in);
+        m_sel0 = bit_select0(m_bits, in);
+    }
+
     inline unary_sorted_sequence(const int_vector& other) {
         *this = other;
     }
@@ -62,15 +70,13 @@ public:
             assert(pos == num_bits);
         }
         
-        // rank + select
-        m_rank = bit_rank(m_bits);
+        // select
         m_sel0 = bit_select0(m_bits);
     }
 
     inline unary_sorted_sequence& operator=(const unary_sorted_sequence& other) {
         m_size = other.m_size;
         m_bits = other.m_bits;
-        m_rank = other.m_rank;
         m_sel0 = other.m_sel0;
         return *this;
     }
@@ -78,19 +84,30 @@ public:
     inline unary_sorted_sequence& operator=(unary_sorted_sequence&& other) {
         m_size = other.m_size;
         m_bits = std::move(other.m_bits);
-        m_rank = std::move(other.m_rank);
         m_sel0 = std::move(other.m_sel0);
         return *this;
     }
 
     inline uint64_t operator[](size_t i) const {
         assert(i < m_size);
-        return m_rank(m_sel0(i+1));
+        return m_sel0(i+1) - i;
     }
 
     inline size_t size() const {
         return m_size;
     }
+
+    // prefetches the select directory entries accessed by access to the i-th value
+    inline void prefetch(size_t i) const {
+        m_sel0.prefetch(i+1);
+    }
+
+    // writes the sequence so that it can be mapped into memory later
+    inline void write(io::serializer& out) const {
+        out.write(m_size);
+        m_bits->write(out);
+        m_sel0.write(out);
+    }
 };
 
 }}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <stash/util/likely.hpp>
+
+#include "linear_probing.hpp"
+#include "reduce.hpp"
+
+namespace stash {
+namespace hash {
+
+// an open addressing hash table like table, but with the hash function,
+// the probing function and the reduction of hash values to slots as template
+// parameters, so that they can be inlined
+//
+// instead of a separate occupancy vector, free slots hold a sentinel key, so
+// each probe touches only a single slot - the sentinel itself may still be
+// inserted and is kept track of separately
+template<typename K, typename hash_func_t, typename probe_func_t = linear_probing<>, typename reduce_t = pow2_reduce>
+class flat_table {
+private:
+    hash_func_t m_hash_func;
+    probe_func_t m_probe_func;
+    reduce_t m_reduce;
+
+    K m_empty;
+    bool m_contains_empty;
+
+    size_t m_cap;
+    size_t m_size; // the number of keys in slots, i.e., excluding the sentinel
+    size_t m_probe_max;
+    double m_load_factor;
+    double m_growth_factor;
+
+    std::vector<K> m_keys;
+
+    // caches to avoid floating point computations on each insert
+    size_t m_size_max;
+    size_t m_size_grow;
+
+    // diagnostics
+    size_t m_probe_total;
+    size_t m_times_resized;
+
+    inline void init(const size_t capacity) {
+        m_size = 0;
+        m_cap = m_reduce.init(capacity);
+        m_probe_max = 0;
+        m_probe_total = 0;
+
+        m_keys = std::vector<K>(m_cap, m_empty);
+
+        m_size_max = size_t(m_load_factor * (double)m_cap);
+        m_size_grow = std::max(m_size_max + 1, size_t((double)m_cap * m_growth_factor));
+    }
+
+    inline size_t hash(const K& key) const {
+        return m_reduce(size_t(m_hash_func(key)));
+    }
+
+    inline void insert_internal(const K& key) {
+        const size_t hkey = hash(key);
+
+        size_t h = hkey;
+        size_t i = 0;
+        size_t probe = 0;
+
+        while(m_keys[h] != m_empty) {
+            i = m_probe_func(i);
+            h = m_reduce.wrap(hkey + i);
+            ++probe;
+        }
+
+        m_probe_total += probe;
+        m_probe_max = std::max(m_probe_max, probe);
+
+        m_keys[h] = key;
+        ++m_size;
+    }
+
+    inline void resize(const size_t new_cap) {
+        ++m_times_resized;
+
+        auto keys = std::move(m_keys);
+        init(new_cap);
+
+        for(const K& key : keys) {
+            if(key != m_empty) insert_internal(key);
+        }
+    }
+
+public:
+    inline flat_table(
+        hash_func_t hash_func,
+        size_t capacity,
+        double load_factor = 1.0,
+        double growth_factor = 2.0,
+        probe_func_t probe_func = probe_func_t{},
+        K empty = std::numeric_limits<K>::max())
+        : m_hash_func(hash_func),
+          m_probe_func(probe_func),
+          m_empty(empty),
+          m_contains_empty(false),
+          m_load_factor(load_factor),
+          m_growth_factor(growth_factor),
+          m_times_resized(0) {
+
+        init(capacity);
+    }
+
+    // the number of keys, including the sentinel if it was inserted
+    inline size_t size() const {
+        return m_size + m_contains_empty;
+    }
+
+    inline size_t capacity() const {
+        return m_cap;
+    }
+
+    inline double load() const {
+        return (double)m_size / (double)m_cap;
+    }
+
+    inline size_t max_probe() const {
+        return m_probe_max;
+    }
+
+    inline double avg_probe() const {
+        return (double)m_probe_total / (double)m_size;
+    }
+
+    inline size_t times_resized() const {
+        return m_times_resized;
+    }
+
+    inline void insert(const K& key) {
+        if(unlikely(key == m_empty)) {
+            // the sentinel cannot be stored in a slot
+            m_contains_empty = true;
+            return;
+        }
+
+        // first, check if growing is necessary
+        if(m_size + 1 > m_size_max) {
+            resize(m_size_grow);
+        }
+
+        // now it's safe to insert
+        insert_internal(key);
+    }
+
+    inline bool contains(const K& key) const {
+        if(unlikely(key == m_empty)) return m_contains_empty;
+
+        const size_t hkey = hash(key);
+
+        size_t h = hkey;
+        if(m_keys[h] == key) {
+            return true;
+        } else {
+            probe_func_t probe_func = m_probe_func;
+            size_t i = 0;
+            for(size_t probe = 0; probe < m_probe_max; probe++) {
+                if(m_keys[h] == m_empty) return false; // key cannot be contained
+
+                i = probe_func(i);
+                h = m_reduce.wrap(hkey + i);
+                if(m_keys[h] == key) return true;
+            }
+            return false; // key not found
+        }
+    }
+};
+
+}}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#include <stash/util/likely.hpp>
+#include <stash/util/math.hpp>
+#include <stash/util/uint128.hpp>
+
+namespace stash {
+namespace hash {
+
+// reduces hash values to slots using a bit mask, rounding the capacity up to
+// the next power of two - the hash function must have good low bits
+struct pow2_reduce {
+    size_t m_mask;
+
+    // returns the capacity actually used for the requested one
+    inline size_t init(const size_t capacity) {
+        const size_t cap = 1ULL << log2_ceil(std::max(capacity, size_t(2)) - 1);
+        m_mask = cap - 1;
+        return cap;
+    }
+
+    // the slot for a hash value
+    inline size_t operator()(const size_t h) const {
+        return h & m_mask;
+    }
+
+    // wraps a slot plus a probing offset around the capacity
+    inline size_t wrap(const size_t i) const {
+        return i & m_mask;
+    }
+};
+
+// reduces hash values to slots using Lemire's multiply-shift ("fastrange"),
+// which works for any capacity but uses the high bits of the hash value
+//
+// hash values that do not cover all 64 bits (e.g., 32-bit keys multiplied by
+// a 32-bit constant) would never hit the last slots directly, so they are
+// first spread using a multiplication by 2^64 divided by the golden ratio
+struct fastrange_reduce {
+    static constexpr uint64_t SPREAD = 0x9E3779B97F4A7C15ULL;
+
+    size_t m_cap;
+
+    inline size_t init(const size_t capacity) {
+        m_cap = std::max(capacity, size_t(1));
+        return m_cap;
+    }
+
+    inline size_t operator()(const size_t h) const {
+        return size_t(((uint128_t)(h * SPREAD) * (uint128_t)m_cap) >> 64ULL);
+    }
+
+    inline size_t wrap(const size_t i) const {
+        return likely(i < m_cap) ? i : i % m_cap;
+    }
+};
+
+}}
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <stash/util/cpu.hpp>
+#include <stash/util/likely.hpp>
+#include <stash/util/math.hpp>
+
+namespace stash {
+namespace hash {
+
+// a hash set in the style of Google's SwissTable (abseil's flat_hash_set)
+//
+// every slot has a control byte, which is either EMPTY, DELETED (a tombstone
+// left by erase) or, for used slots, seven bits of the key's hash value - the
+// slots are probed in groups, the control bytes of which are matched against
+// those seven bits at once using SIMD, so keys are only compared for slots
+// that most likely contain them
+//
+// groups hold 32 slots if the build targets AVX2 and 16 slots otherwise
+// (SSE2); the groups are probed in triangular order, which visits every group
+// since their number is a power of two
+//
+// because a probe only ends at a group with an empty slot, the set works well
+// for load factors of up to about 0.9
+template<typename K, typename hash_func_t>
+class swiss_set {
+public:
+    #if defined(STASH_X86) && defined(__AVX2__)
+    static constexpr size_t GROUP = 32;
+    #else
+    static constexpr size_t GROUP = 16;
+    #endif
+
+private:
+    using mask_t = uint32_t;
+
+    static constexpr int8_t EMPTY = -128;
+    static constexpr int8_t DELETED = -2;
+
+    // the slots in a group whose control bytes equal c
+    static inline mask_t match(const int8_t* ctrl, const int8_t c) {
+        #if defined(STASH_X86) && defined(__AVX2__)
+        const __m256i g = _mm256_loadu_si256((const __m256i*)ctrl);
+        return mask_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(g, _mm256_set1_epi8(c))));
+        #elif defined(STASH_X86)
+        const __m128i g = _mm_loadu_si128((const __m128i*)ctrl);
+        return mask_t(_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8(c))));
+        #else
+        mask_t m = 0;
+        for(size_t i = 0; i < GROUP; i++) m |= mask_t(ctrl[i] == c) << i;
+        return m;
+        #endif
+    }
+
+    // the slots in a group that are empty or deleted, i.e., the ones with
+    // the highest bit of the control byte set
+    static inline mask_t match_free(const int8_t* ctrl) {
+        #if defined(STASH_X86) && defined(__AVX2__)
+        return mask_t(_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)ctrl)));
+        #elif defined(STASH_X86)
+        return mask_t(_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)ctrl)));
+        #else
+        mask_t m = 0;
+        for(size_t i = 0; i < GROUP; i++) m |= mask_t(ctrl[i] < 0) << i;
+        return m;
+        #endif
+    }
+
+    hash_func_t m_hash_func;
+
+    size_t m_cap;
+    size_t m_group_mask;
+    size_t m_size;
+    size_t m_deleted;
+    size_t m_probe_max;
+    double m_load_factor;
+    double m_growth_factor;
+
+    std::vector<int8_t> m_ctrl;
+    std::vector<K>      m_keys;
+
+    // caches to avoid floating point computations on each insert
+    size_t m_size_max;
+
+    // diagnostics
+    size_t m_probe_total;
+    size_t m_times_resized;
+
+    inline void init(const size_t capacity) {
+        const size_t num_groups = 1ULL << log2_ceil(std::max(idiv_ceil(capacity, GROUP), size_t(2)) - 1);
+
+        m_size = 0;
+        m_deleted = 0;
+        m_cap = num_groups * GROUP;
+        m_group_mask = num_groups - 1;
+        m_probe_max = 0;
+        m_probe_total = 0;
+
+        m_ctrl = std::vector<int8_t>(m_cap, EMPTY);
+        m_keys = std::vector<K>(m_cap);
+
+        // at least one slot must remain empty for unsuccessful searches to end
+        m_size_max = std::min(size_t(m_load_factor * (double)m_cap), m_cap - 1);
+    }
+
+    // the first group is determined by the low bits of the hash value,
+    // the control byte is its seven highest bits
+    inline size_t group_of(const size_t h) const {
+        return h & m_group_mask;
+    }
+
+    static inline int8_t tag_of(const size_t h) {
+        return int8_t(h >> 57ULL);
+    }
+
+    // finds the slot containing key, or returns m_cap if it is not contained
+    inline size_t find(const K& key) const {
+        const size_t h = size_t(m_hash_func(key));
+        const int8_t tag = tag_of(h);
+
+        size_t g = group_of(h);
+        for(size_t probe = 1;; probe++) {
+            const int8_t* ctrl = m_ctrl.data() + g * GROUP;
+            for(mask_t m = match(ctrl, tag); m; m &= m - 1) {
+                const size_t i = g * GROUP + __builtin_ctz(m);
+                if(m_keys[i] == key) return i;
+            }
+            if(match(ctrl, EMPTY)) return m_cap; // key cannot be contained
+            g = (g + probe) & m_group_mask;
+        }
+    }
+
+    // inserts a key that is not contained
+    inline void insert_internal(const K& key) {
+        const size_t h = size_t(m_hash_func(key));
+
+        size_t g = group_of(h);
+        size_t probe = 0;
+        mask_t m;
+        while(!(m = match_free(m_ctrl.data() + g * GROUP))) {
+            ++probe;
+            g = (g + probe) & m_group_mask;
+        }
+
+        m_probe_total += probe;
+        m_probe_max = std::max(m_probe_max, probe);
+
+        const size_t i = g * GROUP + __builtin_ctz(m);
+        m_deleted -= (m_ctrl[i] == DELETED);
+        m_ctrl[i] = tag_of(h);
+        m_keys[i] = key;
+        ++m_size;
+    }
+
+    inline void resize(const size_t new_cap) {
+        ++m_times_resized;
+
+        auto old_cap = m_cap;
+        auto ctrl = std::move(m_ctrl);
+        auto keys = std::move(m_keys);
+
+        init(new_cap);
+
+        for(size_t i = 0; i < old_cap; i++) {
+            if(ctrl[i] >= 0) insert_internal(keys[i]);
+        }
+    }
+
+public:
+    inline swiss_set(
+        hash_func_t hash_func,
+        size_t capacity,
+        double load_factor = 0.875,
+        double growth_factor = 2.0)
+        : m_hash_func(hash_func),
+          m_load_factor(load_factor),
+          m_growth_factor(growth_factor),
+          m_times_resized(0) {
+
+        init(capacity);
+    }
+
+    inline size_t size() const {
+        return m_size;
+    }
+
+    inline size_t capacity() const {
+        return m_cap;
+    }
+
+    inline double load() const {
+        return (double)m_size / (double)m_cap;
+    }
+
+    // the maximum number of groups probed beyond the first by an insertion
+    inline size_t max_probe() const {
+        return m_probe_max;
+    }
+
+    inline double avg_probe() const {
+        return (double)m_probe_total / (double)m_size;
+    }
+
+    inline size_t times_resized() const {
+        return m_times_resized;
+    }
+
+    inline void insert(const K& key) {
+        if(find(key) != m_cap) return; // already contained
+
+        // first, check if growing is necessary - tombstones count as used,
+        // but if they make up at least 1/16 of the slots, the set is rebuilt
+        // at the same size, which amortizes to at most 16 moves per erase
+        if(m_size + m_deleted + 1 > m_size_max) {
+            if(m_deleted >= m_cap / 16) {
+                resize(m_cap);
+            } else {
+                resize(std::max(m_cap + 1, size_t((double)m_cap * m_growth_factor)));
+            }
+        }
+
+        // now it's safe to insert
+        insert_internal(key);
+    }
+
+    inline bool contains(const K& key) const {
+        return find(key) != m_cap;
+    }
+
+    // removes key from the set, returns whether it was contained
+    inline bool erase(const K& key) {
+        const size_t i = find(key);
+        if(i == m_cap) return false;
+
+        // if the group has an empty slot, no probe ever went past it, so the
+        // slot can become empty again - otherwise it has to become a tombstone
+        if(match(m_ctrl.data() + (i / GROUP) * GROUP, EMPTY)) {
+            m_ctrl[i] = EMPTY;
+        } else {
+            m_ctrl[i] = DELETED;
+            ++m_deleted;
+        }
+        --m_size;
+        return true;
+    }
+};
+
+}}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <stash/io/mmap_file.hpp>
+
+namespace stash {
+namespace io {
+
+// read-only array of items that are either stored in a memory-mapped binary
+// file (e.g., of uint40_t) or held in memory
+//
+// this can be used as the array_t of predecessor data structures
+// to avoid copying the input into a vector
+template<typename item_t>
+class mapped_array {
+private:
+    std::shared_ptr<const mmap_file> m_file;
+    std::vector<item_t>              m_owned;
+
+    const item_t* m_data;
+    size_t        m_size;
+
+public:
+    inline mapped_array() : m_data(nullptr), m_size(0) {
+    }
+
+    // maps the given file - if that fails, the array is empty
+    inline mapped_array(const std::string& filename)
+        : m_file(std::make_shared<mmap_file>(filename)),
+          m_data((const item_t*)m_file->data()),
+          m_size(m_file->size() / sizeof(item_t)) {
+    }
+
+    // takes ownership of the given items
+    inline mapped_array(std::vector<item_t>&& items)
+        : m_owned(std::move(items)),
+          m_data(m_owned.data()),
+          m_size(m_owned.size()) {
+    }
+
+    inline mapped_array(const mapped_array& other) {
+        *this = other;
+    }
+
+    inline mapped_array(mapped_array&& other) {
+        *this = std::move(other);
+    }
+
+    inline mapped_array& operator=(const mapped_array& other) {
+        m_file = other.m_file;
+        m_owned = other.m_owned;
+        m_data = m_file ? other.m_data : m_owned.data();
+        m_size = other.m_size;
+        return *this;
+    }
+
+    inline mapped_array& operator=(mapped_array&& other) {
+        m_file = std::move(other.m_file);
+        m_owned = std::move(other.m_owned);
+        m_data = m_file ? other.m_data : m_owned.data();
+        m_size = other.m_size;
+        return *this;
+    }
+
+    inline const item_t& operator[](const size_t i) const {
+        return m_data[i];
+    }
+
+    inline size_t size() const {
+        return m_size;
+    }
+
+    inline const item_t* data() const {
+        return m_data;
+    }
+
+    inline const item_t* begin() const {
+        return m_data;
+    }
+
+    inline const item_t* end() const {
+        return m_data + m_size;
+    }
+};
+
+}}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace stash {
+namespace io {
+
+// maps a file into memory for reading
+// the mapping is released when the object is destroyed
+class mmap_file {
+private:
+    const void* m_data;
+    size_t      m_size;
+
+public:
+    inline mmap_file() : m_data(nullptr), m_size(0) {
+    }
+
+    // maps the given file - if that fails, the mapping is empty
+    inline mmap_file(const std::string& filename) : mmap_file() {
+        const int fd = ::open(filename.c_str(), O_RDONLY);
+        if(fd < 0) return;
+
+        struct stat st;
+        if(::fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* p = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if(p != MAP_FAILED) {
+                m_data = p;
+                m_size = size_t(st.st_size);
+            }
+        }
+
+        // the mapping stays valid after closing the file
+        ::close(fd);
+    }
+
+    mmap_file(const mmap_file&) = delete;
+    mmap_file& operator=(const mmap_file&) = delete;
+
+    inline ~mmap_file() {
+        if(m_data) ::munmap(const_cast<void*>(m_data), m_size);
+    }
+
+    inline const void* data() const {
+        return m_data;
+    }
+
+    inline size_t size() const {
+        return m_size;
+    }
+
+    inline operator bool() const {
+        return m_data != nullptr;
+    }
+};
+
+}}
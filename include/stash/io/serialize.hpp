@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include <stash/io/mmap_file.hpp>
+
+namespace stash {
+namespace io {
+
+// identifies files written by serializer ("STASH" in little endian)
+constexpr uint64_t FORMAT_MAGIC = 0x4853415453ULL;
+
+// incremented whenever the layout of any serialized structure changes
+constexpr uint64_t FORMAT_VERSION = 4;
+
+// writes data structures to a file in a format that can be mapped
+// into memory using mapped_reader without any decoding
+//
+// everything is written in units of 64-bit words, so that word arrays
+// are properly aligned when the file is mapped
+class serializer {
+private:
+    std::ofstream m_out;
+
+public:
+    inline serializer(const std::string& filename)
+        : m_out(filename, std::ios::binary | std::ios::trunc) {
+
+        write(FORMAT_MAGIC);
+        write(FORMAT_VERSION);
+    }
+
+    inline void write(const uint64_t x) {
+        m_out.write((const char*)&x, sizeof(x));
+    }
+
+    inline void write(const uint64_t* words, const size_t num) {
+        m_out.write((const char*)words, num * sizeof(uint64_t));
+    }
+
+    inline operator bool() const {
+        return bool(m_out);
+    }
+};
+
+// reads data structures from a file written by serializer
+// word arrays are not copied, but point into the mapped file
+class mapped_reader {
+private:
+    std::shared_ptr<const mmap_file> m_file;
+    const uint64_t* m_pos;
+    const uint64_t* m_end;
+    bool m_good;
+
+public:
+    inline mapped_reader(const std::string& filename)
+        : m_file(std::make_shared<mmap_file>(filename)),
+          m_pos((const uint64_t*)m_file->data()),
+          m_end(m_pos + m_file->size() / sizeof(uint64_t)),
+          m_good(bool(*m_file)) {
+
+        // check header
+        expect(FORMAT_MAGIC);
+        expect(FORMAT_VERSION);
+    }
+
+    inline uint64_t read() {
+        if(m_pos >= m_end) {
+            m_good = false;
+            return 0;
+        }
+        return *m_pos++;
+    }
+
+    // reads a value and marks the reader as bad if it is not the expected one
+    inline void expect(const uint64_t x) {
+        if(read() != x) m_good = false;
+    }
+
+    // returns a pointer to the next num words in the mapped file
+    inline const uint64_t* read(const size_t num) {
+        const uint64_t* words = m_pos;
+        if(size_t(m_end - m_pos) < num) {
+            m_good = false;
+            m_pos = m_end;
+        } else {
+            m_pos += num;
+        }
+        return words;
+    }
+
+    // the mapped file - structures that point into it must keep it alive
+    inline std::shared_ptr<const void> mapping() const {
+        return m_file;
+    }
+
+    inline operator bool() const {
+        return m_good;
+    }
+};
+
+}}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+
 #include <stash/pred/result.hpp>
 #include <stash/pred/util.hpp>
 
@@ -111,6 +113,110 @@ public:
 
         return result { true, q };
     }
+
+    // answers n predecessor queries, interleaving the binary searches of
+    // BATCH_SIZE queries at a time so their memory accesses overlap
+    inline void predecessor_batch(const item_t* xs, const size_t n, result* out) const {
+        query_group<item_t> g;
+        for(size_t i = 0; i < n; i += BATCH_SIZE) {
+            const size_t end = std::min(i + BATCH_SIZE, n);
+
+            g.num = 0;
+            for(size_t j = i; j < end; j++) {
+                const item_t x = xs[j];
+                if(unlikely(x < m_min))       out[j] = result { false, 0 };
+                else if(unlikely(x >= m_max)) out[j] = result { true, m_num-1 };
+                else                          g.add(x, j);
+            }
+
+            for(size_t k = 0; k < g.num; k++) {
+                g.p[k] = 0;
+                g.q[k] = m_num - 1;
+            }
+
+            // all searches start on the same interval and thus take
+            // the same number of steps, give or take one
+            for(bool any = (g.num > 0); any;) {
+                // prefetch the next probes
+                any = false;
+                for(size_t k = 0; k < g.num; k++) {
+                    if(g.q[k] - g.p[k] > 1) {
+                        prefetch(*m_array, (g.p[k] + g.q[k]) >> 1ULL);
+                        any = true;
+                    }
+                }
+
+                // do one search step per query
+                for(size_t k = 0; k < g.num; k++) {
+                    const size_t p = g.p[k];
+                    const size_t q = g.q[k];
+                    if(q - p > 1) {
+                        const size_t m = (p + q) >> 1ULL;
+                        const size_t le_mask = -size_t((*m_array)[m] <= g.x[k]);
+                        const size_t gt_mask = ~le_mask;
+
+                        g.p[k] = (le_mask & m) | (gt_mask & p);
+                        g.q[k] = (gt_mask & m) | (le_mask & q);
+                    }
+                }
+            }
+
+            for(size_t k = 0; k < g.num; k++) {
+                out[g.j[k]] = result { true, g.p[k] };
+            }
+        }
+    }
+
+    // answers n successor queries, interleaving the binary searches of
+    // BATCH_SIZE queries at a time so their memory accesses overlap
+    inline void successor_batch(const item_t* xs, const size_t n, result* out) const {
+        query_group<item_t> g;
+        for(size_t i = 0; i < n; i += BATCH_SIZE) {
+            const size_t end = std::min(i + BATCH_SIZE, n);
+
+            g.num = 0;
+            for(size_t j = i; j < end; j++) {
+                const item_t x = xs[j];
+                if(unlikely(x <= m_min))     out[j] = result { true, 0 };
+                else if(unlikely(x > m_max)) out[j] = result { false, 0 };
+                else                         g.add(x, j);
+            }
+
+            for(size_t k = 0; k < g.num; k++) {
+                g.p[k] = 0;
+                g.q[k] = m_num - 1;
+            }
+
+            for(bool any = (g.num > 0); any;) {
+                // prefetch the next probes
+                any = false;
+                for(size_t k = 0; k < g.num; k++) {
+                    if(g.q[k] - g.p[k] > 1) {
+                        prefetch(*m_array, (g.p[k] + g.q[k]) >> 1ULL);
+                        any = true;
+                    }
+                }
+
+                // do one search step per query
+                for(size_t k = 0; k < g.num; k++) {
+                    const size_t p = g.p[k];
+                    const size_t q = g.q[k];
+                    if(q - p > 1) {
+                        const size_t m = (p + q) >> 1ULL;
+                        const size_t lt_mask = -size_t((*m_array)[m] < g.x[k]);
+                        const size_t ge_mask = ~lt_mask;
+
+                        g.p[k] = (lt_mask & m) | (ge_mask & p);
+                        g.q[k] = (ge_mask & m) | (lt_mask & q);
+                    }
+                }
+            }
+
+            for(size_t k = 0; k < g.num; k++) {
+                out[g.j[k]] = result { true, g.q[k] };
+            }
+        }
+    }
 };
 
 }}
@@ -1,12 +1,21 @@
 #pragma once
 
+#include <algorithm>
+
 #include <stash/pred/result.hpp>
+#include <stash/pred/search.hpp>
 #include <stash/pred/util.hpp>
 
 namespace stash {
 namespace pred {
 
-template<typename array_t, typename item_t, size_t m_cache_num = 512ULL / sizeof(item_t)>
+// search_t is the policy used to narrow down the search interval before
+// the linear search, see search.hpp - batched queries always use bisection
+template<
+    typename array_t,
+    typename item_t,
+    size_t m_cache_num = 512ULL / sizeof(item_t),
+    typename search_t = search::bisection>
 class binsearch_cache {
 private:
     const array_t* m_array;
@@ -53,23 +62,7 @@ public:
 
     inline result predecessor_seeded(const item_t x, size_t p, size_t q) const {
         assert(x >= m_min && x < m_max);
-        while(q - p > m_cache_num) {
-            assert(x >= (*m_array)[p]);
-
-            const size_t m = (p + q) >> 1ULL;
-
-            const bool le = ((*m_array)[m] <= x);
-
-            /*
-                the following is a fast form of:
-                if(le) p = m; else q = m;
-            */
-            const size_t le_mask = -size_t(le);
-            const size_t gt_mask = ~le_mask;
-
-            p = (le_mask & m) | (gt_mask & p);
-            q = (gt_mask & m) | (le_mask & q);
-        }
+        search_t::template narrow<m_cache_num, true>(*m_array, x, p, q);
 
         // linear search
         while((*m_array)[p] <= x) ++p;
@@ -84,27 +77,74 @@ public:
         return predecessor_seeded(x, 0, m_num - 1);
     }
 
-    inline result successor_seeded(const item_t x, size_t p, size_t q) const {
-        assert(x >= m_min && x < m_max);
-        while(q - p > m_cache_num) {
-            assert(x > (*m_array)[p]);
-            assert(x <= (*m_array)[q]);
-
-            const size_t m = (p + q) >> 1ULL;
-
-            const bool lt = ((*m_array)[m] < x);
+    // interleaved form of predecessor_seeded for a group of queries,
+    // the results are written to out at the queries' batch positions
+    inline void predecessor_seeded_batch(query_group<item_t>& g, result* out) const {
+        for(bool any = (g.num > 0); any;) {
+            // prefetch the next probes
+            any = false;
+            for(size_t k = 0; k < g.num; k++) {
+                if(g.q[k] - g.p[k] > m_cache_num) {
+                    prefetch(*m_array, (g.p[k] + g.q[k]) >> 1ULL);
+                    any = true;
+                }
+            }
+
+            // do one binary search step per query
+            for(size_t k = 0; k < g.num; k++) {
+                const size_t p = g.p[k];
+                const size_t q = g.q[k];
+                if(q - p > m_cache_num) {
+                    const size_t m = (p + q) >> 1ULL;
+                    const size_t le_mask = -size_t((*m_array)[m] <= g.x[k]);
+                    const size_t gt_mask = ~le_mask;
+
+                    g.p[k] = (le_mask & m) | (gt_mask & p);
+                    g.q[k] = (gt_mask & m) | (le_mask & q);
+                }
+            }
+        }
 
+        // prefetch the intervals for linear search
+        for(size_t k = 0; k < g.num; k++) {
+            prefetch_range(*m_array, g.p[k], g.q[k]);
+        }
 
-            /*
-                the following is a fast form of:
-                if(lt) p = m; else q = m;
-            */
-            const size_t lt_mask = -size_t(lt);
-            const size_t ge_mask = ~lt_mask;
+        // linear search
+        for(size_t k = 0; k < g.num; k++) {
+            const item_t x = g.x[k];
+            size_t p = g.p[k];
+            while((*m_array)[p] <= x) ++p;
+            out[g.j[k]] = result { true, p-1 };
+        }
+    }
 
-            p = (lt_mask & m) | (ge_mask & p);
-            q = (ge_mask & m) | (lt_mask & q);
+    // answers n predecessor queries in groups of BATCH_SIZE, see predecessor_seeded_batch
+    inline void predecessor_batch(const item_t* xs, const size_t n, result* out) const {
+        query_group<item_t> g;
+        for(size_t i = 0; i < n; i += BATCH_SIZE) {
+            const size_t end = std::min(i + BATCH_SIZE, n);
+
+            g.num = 0;
+            for(size_t j = i; j < end; j++) {
+                const item_t x = xs[j];
+                if(unlikely(x < m_min))       out[j] = result { false, 0 };
+                else if(unlikely(x >= m_max)) out[j] = result { true, m_num-1 };
+                else                          g.add(x, j);
+            }
+
+            for(size_t k = 0; k < g.num; k++) {
+                g.p[k] = 0;
+                g.q[k] = m_num - 1;
+            }
+
+            predecessor_seeded_batch(g, out);
         }
+    }
+
+    inline result successor_seeded(const item_t x, size_t p, size_t q) const {
+        assert(x > m_min && x <= m_max);
+        search_t::template narrow<m_cache_num, false>(*m_array, x, p, q);
 
         // linear search
         while((*m_array)[p] < x) ++p;
@@ -118,6 +158,71 @@ public:
         if(unlikely(x > m_max))  return result { false, 0 };
         return successor_seeded(x, 0, m_num - 1);
     }
+
+    // interleaved form of successor_seeded for a group of queries,
+    // the results are written to out at the queries' batch positions
+    inline void successor_seeded_batch(query_group<item_t>& g, result* out) const {
+        for(bool any = (g.num > 0); any;) {
+            // prefetch the next probes
+            any = false;
+            for(size_t k = 0; k < g.num; k++) {
+                if(g.q[k] - g.p[k] > m_cache_num) {
+                    prefetch(*m_array, (g.p[k] + g.q[k]) >> 1ULL);
+                    any = true;
+                }
+            }
+
+            // do one binary search step per query
+            for(size_t k = 0; k < g.num; k++) {
+                const size_t p = g.p[k];
+                const size_t q = g.q[k];
+                if(q - p > m_cache_num) {
+                    const size_t m = (p + q) >> 1ULL;
+                    const size_t lt_mask = -size_t((*m_array)[m] < g.x[k]);
+                    const size_t ge_mask = ~lt_mask;
+
+                    g.p[k] = (lt_mask & m) | (ge_mask & p);
+                    g.q[k] = (ge_mask & m) | (lt_mask & q);
+                }
+            }
+        }
+
+        // prefetch the intervals for linear search
+        for(size_t k = 0; k < g.num; k++) {
+            prefetch_range(*m_array, g.p[k], g.q[k]);
+        }
+
+        // linear search
+        for(size_t k = 0; k < g.num; k++) {
+            const item_t x = g.x[k];
+            size_t p = g.p[k];
+            while((*m_array)[p] < x) ++p;
+            out[g.j[k]] = result { true, p };
+        }
+    }
+
+    // answers n successor queries in groups of BATCH_SIZE, see successor_seeded_batch
+    inline void successor_batch(const item_t* xs, const size_t n, result* out) const {
+        query_group<item_t> g;
+        for(size_t i = 0; i < n; i += BATCH_SIZE) {
+            const size_t end = std::min(i + BATCH_SIZE, n);
+
+            g.num = 0;
+            for(size_t j = i; j < end; j++) {
+                const item_t x = xs[j];
+                if(unlikely(x <= m_min))     out[j] = result { true, 0 };
+                else if(unlikely(x > m_max)) out[j] = result { false, 0 };
+                else                         g.add(x, j);
+            }
+
+            for(size_t k = 0; k < g.num; k++) {
+                g.p[k] = 0;
+                g.q[k] = m_num - 1;
+            }
+
+            successor_seeded_batch(g, out);
+        }
+    }
 };
 
 }}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <stash/pred/result.hpp>
+#include <stash/pred/util.hpp>
+
+#include <stash/pred/binsearch_cache.hpp>
+#include <stash/util/math.hpp>
+#include <stash/vec/int_vector.hpp>
+
+namespace stash {
+namespace pred {
+
+// 64-ary bit tree (a van Emde Boas-style trie of 64-bit words) over the
+// buckets defined by the high bits (x >> m_lo_bits) of the items
+//
+// every level holds a word only for each non-empty group of 64 siblings,
+// so unlike rank, the required RAM depends on the number of items and not on
+// the universe - each word is stored along with the number of set bits in the
+// preceding words of its level, which is the position of its first child on
+// the next level, so a query descends one word per level using popcount
+//
+// the position of the first item of each non-empty bucket is stored, and buckets
+// are searched using binsearch_cache - for m_lo_bits = 0, each bucket holds a
+// single distinct value and no search is needed
+template<
+    typename array_t,
+    typename item_t,
+    size_t m_lo_bits = 0,
+    size_t m_cache_num = 512ULL / sizeof(item_t),
+    typename search_t = search::bisection>
+class bit_tree {
+private:
+    static constexpr uint64_t hi(uint64_t x) {
+        return x >> m_lo_bits;
+    }
+
+    // a word of the tree along with the number of set bits in the
+    // preceding words of its level (stored together to share a cache line)
+    struct node {
+        uint64_t bits;
+        uint64_t base;
+    };
+
+    const array_t* m_array;
+    size_t m_num;
+    item_t m_min;
+    item_t m_max;
+
+    uint64_t m_key_min;
+
+    // the levels of the tree, root first - each ends with a sentinel
+    // node containing the total number of set bits on the level
+    std::vector<std::vector<node>> m_levels;
+
+    // position of the first item of each non-empty bucket, followed by m_num
+    int_vector m_pos;
+
+    using lo_pred_t = binsearch_cache<array_t, item_t, m_cache_num, search_t>;
+    lo_pred_t m_lo_pred;
+
+    // counts the non-empty buckets up to and including bucket b
+    // and reports whether bucket b is non-empty
+    inline size_t rank_le(const uint64_t b, bool& exact) const {
+        const size_t height = m_levels.size();
+
+        size_t i = 0;
+        for(size_t l = 0; l < height; l++) {
+            const node& v = m_levels[l][i];
+            const uint64_t d = (b >> (6ULL * (height - 1 - l))) & 63ULL;
+
+            // position of the child for d on the next level, or,
+            // on the last level, the number of non-empty buckets before b
+            i = v.base + __builtin_popcountll(v.bits & ((1ULL << d) - 1ULL));
+
+            if(!(v.bits & (1ULL << d))) {
+                // b is empty - the buckets before it are those before the
+                // subtree of the next child, found by following the first children
+                for(size_t k = l + 1; k < height; k++) {
+                    i = m_levels[k][i].base;
+                }
+
+                exact = false;
+                return i;
+            }
+        }
+
+        exact = true;
+        return i + 1;
+    }
+
+public:
+    inline bit_tree(const array_t& array)
+        : m_array(&array),
+          m_num(array.size()),
+          m_min(array[0]),
+          m_max(array[m_num-1]),
+          m_key_min(hi(m_min)) {
+
+        assert_sorted_ascending(array);
+
+        // gather non-empty buckets and their first items
+        std::vector<uint64_t> keys;
+        std::vector<size_t>   first;
+        for(size_t i = 0; i < m_num; i++) {
+            const uint64_t b = hi(array[i]) - m_key_min;
+            if(keys.empty() || keys.back() != b) {
+                keys.push_back(b);
+                first.push_back(i);
+            }
+        }
+
+        m_pos = int_vector(first.size() + 1, log2_ceil(m_num));
+        for(size_t i = 0; i < first.size(); i++) {
+            m_pos[i] = first[i];
+        }
+        m_pos[first.size()] = m_num;
+
+        // build levels bottom-up, each from the distinct parents of the one below
+        const uint64_t key_bits = keys.back() ? log2_ceil(keys.back()) : 1ULL;
+        const size_t height = idiv_ceil(key_bits, 6ULL);
+        m_levels.resize(height);
+
+        for(size_t l = height; l-- > 0;) {
+            auto& level = m_levels[l];
+
+            std::vector<uint64_t> parents;
+            uint64_t num_bits = 0;
+            for(const uint64_t k : keys) {
+                const uint64_t p = k >> 6ULL;
+                if(parents.empty() || parents.back() != p) {
+                    parents.push_back(p);
+                    level.push_back(node { 0, num_bits });
+                }
+                level.back().bits |= 1ULL << (k & 63ULL);
+                ++num_bits;
+            }
+
+            level.push_back(node { 0, num_bits }); // sentinel
+            level.shrink_to_fit();
+            keys = std::move(parents);
+        }
+        assert(m_levels[0].size() == 2);
+
+        m_lo_pred = lo_pred_t(array);
+    }
+
+    inline result predecessor(const item_t x) const {
+        if(unlikely(x < m_min))  return result { false, 0 };
+        if(unlikely(x >= m_max)) return result { true, m_num-1 };
+
+        bool exact;
+        const size_t r = rank_le(hi(x) - m_key_min, exact);
+
+        if constexpr(m_lo_bits > 0) {
+            if(exact) {
+                const size_t p = m_pos[r-1];
+                if((*m_array)[p] <= x) {
+                    const size_t q = std::min(size_t(m_pos[r]), m_num - 1);
+                    return m_lo_pred.predecessor_seeded(x, p, q);
+                }
+                // all items in the bucket are greater than x
+                return result { true, p - 1 };
+            }
+        }
+
+        // the predecessor is the last item of the last bucket before x
+        return result { true, size_t(m_pos[r]) - 1 };
+    }
+
+    inline result successor(const item_t x) const {
+        if(unlikely(x <= m_min)) return result { true, 0 };
+        if(unlikely(x > m_max))  return result { false, 0 };
+
+        bool exact;
+        const size_t r = rank_le(hi(x) - m_key_min, exact);
+
+        if(exact) {
+            const size_t p = m_pos[r-1];
+            if constexpr(m_lo_bits > 0) {
+                const size_t q = size_t(m_pos[r]) - 1;
+                if((*m_array)[q] >= x) {
+                    return m_lo_pred.successor_seeded(x, p, q);
+                }
+                // all items in the bucket are less than x
+                return result { true, q + 1 };
+            } else {
+                return result { true, p };
+            }
+        }
+
+        // the successor is the first item of the first bucket after x
+        return result { true, size_t(m_pos[r]) };
+    }
+};
+
+}}
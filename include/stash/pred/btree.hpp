@@ -0,0 +1,499 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include <stash/pred/result.hpp>
+#include <stash/pred/util.hpp>
+
+#include <stash/pred/node_search.hpp>
+#include <stash/util/math.hpp>
+
+namespace stash {
+namespace pred {
+
+// dynamic predecessor set implemented as a B+-tree that supports insertions
+// and deletions - unlike the static structures, it stores the keys itself
+//
+// leaves hold up to m_leaf_cap keys and inner nodes up to m_fanout children,
+// both of which are searched using SIMD compares (see node_search) if key_t is
+// a native unsigned integer type (e.g., uint64_t for uint40_t)
+//
+// inner nodes store the size of each child's subtree, so that queries report
+// the rank of the predecessor or successor in the current set as the position
+//
+// duplicates in the input array are kept, so that the positions reported by
+// queries index the input array as long as there were no updates - insert
+// only adds keys that are not contained, and erase removes one occurrence
+//
+// nodes are split when they overflow, but not merged when they underflow -
+// empty nodes are removed, and the whole tree is rebuilt once the leaves are
+// less than a quarter full on average, so that the rebuild cost is amortized
+// over the deletions that caused it
+template<
+    typename item_t,
+    typename key_t = item_t,
+    size_t m_leaf_cap = 64,
+    size_t m_fanout = 16>
+class btree {
+private:
+    static_assert(m_leaf_cap >= 4 && m_fanout >= 4, "nodes must have a capacity of at least four");
+
+    static constexpr bool m_simd = std::is_unsigned<key_t>::value;
+
+    // padding so that SIMD searches may read one cache line beyond the keys
+    static constexpr size_t m_pad = 64ULL / sizeof(key_t);
+
+    // nodes are filled to this degree on construction
+    static constexpr size_t m_leaf_fill = std::max(m_leaf_cap * 3 / 4, size_t(1));
+    static constexpr size_t m_inner_fill = std::max(m_fanout * 3 / 4, size_t(2));
+
+    static constexpr size_t m_max_height = 32;
+
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    // nodes may hold one entry more than their capacity before they are split
+    struct leaf {
+        key_t    keys[m_leaf_cap + 1 + m_pad];
+        uint32_t num;
+        uint32_t prev;
+        uint32_t next;
+    };
+
+    struct inner {
+        key_t    keys[m_fanout + 1 + m_pad]; // lower bounds of the children's keys
+        size_t   sizes[m_fanout + 1];        // number of keys in the children's subtrees
+        uint32_t children[m_fanout + 1];
+        uint32_t num;
+    };
+
+    // a step on the way from the root to a leaf
+    struct step {
+        uint32_t node;
+        uint32_t child;
+    };
+
+    // counts the keys that are less than or equal to x among the first n
+    static inline size_t count_le(const key_t* keys, const size_t n, const key_t x) {
+        if constexpr(m_simd) {
+            return node_search<key_t>::rank_le(keys, n, x);
+        } else {
+            return size_t(std::upper_bound(keys, keys + n, x) - keys);
+        }
+    }
+
+    std::vector<leaf>     m_leaves;
+    std::vector<uint32_t> m_free_leaves;
+    std::vector<inner>    m_inner;
+    std::vector<uint32_t> m_free_inner;
+
+    uint32_t m_root;       // a leaf if m_height is zero
+    size_t   m_height;     // number of inner levels
+    uint32_t m_head;       // the leftmost leaf
+    size_t   m_num_leaves; // number of leaves in use
+    size_t   m_size;       // number of keys
+
+    inline uint32_t new_leaf() {
+        ++m_num_leaves;
+        if(m_free_leaves.empty()) {
+            m_leaves.emplace_back();
+            return uint32_t(m_leaves.size() - 1);
+        } else {
+            const uint32_t v = m_free_leaves.back();
+            m_free_leaves.pop_back();
+            return v;
+        }
+    }
+
+    inline uint32_t new_inner() {
+        if(m_free_inner.empty()) {
+            m_inner.emplace_back();
+            return uint32_t(m_inner.size() - 1);
+        } else {
+            const uint32_t v = m_free_inner.back();
+            m_free_inner.pop_back();
+            return v;
+        }
+    }
+
+    // moves the path to the leaf left of the one it ends at, which is returned,
+    // or returns NONE if the path ends at the leftmost leaf
+    inline uint32_t prev_leaf(step* path) const {
+        size_t h = m_height;
+        while(h > 0 && path[h-1].child == 0) --h;
+        if(h == 0) return NONE;
+
+        --path[h-1].child;
+        uint32_t v = m_inner[path[h-1].node].children[path[h-1].child];
+        for(; h < m_height; h++) {
+            const inner& node = m_inner[v];
+            path[h] = step { v, node.num - 1 };
+            v = node.children[node.num - 1];
+        }
+        return v;
+    }
+
+    // finds the leaf that x belongs into and records the path to it
+    // rank receives the number of keys in the leaves left of it
+    inline uint32_t descend(const key_t x, size_t& rank, step* path) const {
+        rank = 0;
+        uint32_t v = m_root;
+        for(size_t h = 0; h < m_height; h++) {
+            const inner& node = m_inner[v];
+            const size_t c = count_le(node.keys, node.num, x);
+            const size_t i = c ? c - 1 : 0;
+            for(size_t j = 0; j < i; j++) rank += node.sizes[j];
+
+            path[h] = step { v, uint32_t(i) };
+            v = node.children[i];
+        }
+        return v;
+    }
+
+    // inserts the child v with the given lower bound key and subtree size into
+    // the parent of the node on level h of the path, right of that node,
+    // which has a subtree size of left_size after the split
+    inline void insert_child(
+        const size_t h, const step* path,
+        const uint32_t v, const key_t key, const size_t size, const size_t left_size) {
+
+        if(h == 0) {
+            // the root was split, grow a new root
+            assert(m_height < m_max_height);
+            const uint32_t root = new_inner();
+            inner& node = m_inner[root];
+            node.num = 2;
+            node.keys[0] = key_t();
+            node.keys[1] = key;
+            node.sizes[0] = left_size;
+            node.sizes[1] = size;
+            node.children[0] = m_root;
+            node.children[1] = v;
+
+            m_root = root;
+            ++m_height;
+            return;
+        }
+
+        const uint32_t u = path[h-1].node;
+        const size_t   i = path[h-1].child;
+        {
+            inner& node = m_inner[u];
+            std::copy_backward(node.keys + i + 1, node.keys + node.num, node.keys + node.num + 1);
+            std::copy_backward(node.sizes + i + 1, node.sizes + node.num, node.sizes + node.num + 1);
+            std::copy_backward(node.children + i + 1, node.children + node.num, node.children + node.num + 1);
+            node.keys[i+1] = key;
+            node.sizes[i] = left_size;
+            node.sizes[i+1] = size;
+            node.children[i+1] = v;
+            ++node.num;
+
+            if(node.num <= m_fanout) return;
+        }
+
+        // split the node
+        const uint32_t w = new_inner();
+        inner& a = m_inner[u];
+        inner& b = m_inner[w];
+
+        const size_t half = a.num / 2;
+        b.num = a.num - half;
+        std::copy(a.keys + half, a.keys + a.num, b.keys);
+        std::copy(a.sizes + half, a.sizes + a.num, b.sizes);
+        std::copy(a.children + half, a.children + a.num, b.children);
+        a.num = half;
+
+        size_t a_size = 0, b_size = 0;
+        for(size_t j = 0; j < a.num; j++) a_size += a.sizes[j];
+        for(size_t j = 0; j < b.num; j++) b_size += b.sizes[j];
+
+        insert_child(h - 1, path, w, b.keys[0], b_size, a_size);
+    }
+
+    // removes the node on level h of the path from its parent,
+    // which is removed as well if it becomes empty
+    inline void remove_child(const size_t h, const step* path) {
+        assert(h > 0);
+
+        const uint32_t u = path[h-1].node;
+        const size_t   i = path[h-1].child;
+
+        // the first key is kept, because it is the lower bound of the whole node
+        inner& node = m_inner[u];
+        const size_t k = std::max(i, size_t(1));
+        if(k < node.num) std::copy(node.keys + k + 1, node.keys + node.num, node.keys + k);
+        std::copy(node.sizes + i + 1, node.sizes + node.num, node.sizes + i);
+        std::copy(node.children + i + 1, node.children + node.num, node.children + i);
+        --node.num;
+
+        if(node.num == 0) {
+            m_free_inner.push_back(u);
+            remove_child(h - 1, path);
+        }
+    }
+
+    // builds the tree bottom-up from the given sorted keys
+    inline void build(const std::vector<key_t>& keys) {
+        m_leaves.clear();
+        m_free_leaves.clear();
+        m_inner.clear();
+        m_free_inner.clear();
+        m_num_leaves = 0;
+        m_size = keys.size();
+
+        // leaves
+        const size_t n = keys.size();
+        const size_t num_leaves = std::max(idiv_ceil(n, m_leaf_fill), size_t(1));
+        m_leaves.reserve(num_leaves);
+
+        std::vector<uint32_t> nodes;
+        std::vector<key_t>    mins;
+        std::vector<size_t>   sizes;
+        nodes.reserve(num_leaves);
+        mins.reserve(num_leaves);
+        sizes.reserve(num_leaves);
+
+        for(size_t k = 0; k < num_leaves; k++) {
+            const uint32_t v = new_leaf();
+            leaf& l = m_leaves[v];
+
+            const size_t i = k * m_leaf_fill;
+            const size_t j = std::min(i + m_leaf_fill, n);
+            std::copy(keys.begin() + i, keys.begin() + j, l.keys);
+            l.num = uint32_t(j - i);
+            l.prev = k ? v - 1 : NONE;
+            l.next = (k + 1 < num_leaves) ? v + 1 : NONE;
+
+            nodes.push_back(v);
+            mins.push_back(l.num ? l.keys[0] : key_t());
+            sizes.push_back(l.num);
+        }
+        m_head = nodes[0];
+
+        // inner levels
+        m_height = 0;
+        while(nodes.size() > 1) {
+            const size_t num = idiv_ceil(nodes.size(), m_inner_fill);
+            for(size_t k = 0; k < num; k++) {
+                const uint32_t v = new_inner();
+                inner& node = m_inner[v];
+
+                const size_t i = k * m_inner_fill;
+                const size_t j = std::min(i + m_inner_fill, nodes.size());
+                std::copy(mins.begin() + i, mins.begin() + j, node.keys);
+                std::copy(sizes.begin() + i, sizes.begin() + j, node.sizes);
+                std::copy(nodes.begin() + i, nodes.begin() + j, node.children);
+                node.num = uint32_t(j - i);
+
+                // the children of a level are written in order, so this is in place
+                size_t size = 0;
+                for(size_t c = 0; c < node.num; c++) size += node.sizes[c];
+                nodes[k] = v;
+                mins[k] = node.keys[0];
+                sizes[k] = size;
+            }
+
+            nodes.resize(num);
+            mins.resize(num);
+            sizes.resize(num);
+            ++m_height;
+        }
+        m_root = nodes[0];
+    }
+
+    // rebuilds the tree from its current keys
+    inline void rebuild() {
+        std::vector<key_t> keys;
+        keys.reserve(m_size);
+        for(uint32_t v = m_head; v != NONE; v = m_leaves[v].next) {
+            const leaf& l = m_leaves[v];
+            keys.insert(keys.end(), l.keys, l.keys + l.num);
+        }
+        build(keys);
+    }
+
+public:
+    inline btree() {
+        build(std::vector<key_t>());
+    }
+
+    // constructs the set of items in the given array, which must be sorted
+    template<typename array_t>
+    inline btree(const array_t& array) {
+        assert_sorted_ascending(array);
+
+        std::vector<key_t> keys;
+        keys.reserve(array.size());
+        for(size_t i = 0; i < array.size(); i++) {
+            keys.push_back(key_t(array[i]));
+        }
+        build(keys);
+    }
+
+    // inserts x, returns false if it was already contained
+    inline bool insert(const item_t x) {
+        const key_t k = key_t(x);
+
+        step path[m_max_height];
+        size_t rank;
+        const uint32_t v = descend(k, rank, path);
+
+        {
+            leaf& l = m_leaves[v];
+            const size_t c = count_le(l.keys, l.num, k);
+            if(c && l.keys[c-1] == k) return false;
+
+            // a run of duplicates may end in the previous leaf
+            if(!c && l.prev != NONE) {
+                const leaf& p = m_leaves[l.prev];
+                if(p.keys[p.num-1] == k) return false;
+            }
+
+            std::copy_backward(l.keys + c, l.keys + l.num, l.keys + l.num + 1);
+            l.keys[c] = k;
+            ++l.num;
+            ++m_size;
+
+            // the first key of a node must remain a lower bound for its subtree,
+            // so that the keys stay sorted when children are inserted after a split
+            for(size_t h = 0; h < m_height; h++) {
+                inner& node = m_inner[path[h].node];
+                ++node.sizes[path[h].child];
+                if(k < node.keys[0]) node.keys[0] = k;
+            }
+
+            if(l.num <= m_leaf_cap) return true;
+        }
+
+        // split the leaf
+        const uint32_t w = new_leaf();
+        leaf& a = m_leaves[v];
+        leaf& b = m_leaves[w];
+
+        const size_t half = a.num / 2;
+        b.num = a.num - half;
+        std::copy(a.keys + half, a.keys + a.num, b.keys);
+        a.num = half;
+
+        b.prev = v;
+        b.next = a.next;
+        if(a.next != NONE) m_leaves[a.next].prev = w;
+        a.next = w;
+
+        insert_child(m_height, path, w, b.keys[0], b.num, a.num);
+        return true;
+    }
+
+    // removes one occurrence of x, returns false if it was not contained
+    inline bool erase(const item_t x) {
+        const key_t k = key_t(x);
+
+        step path[m_max_height];
+        size_t rank;
+        uint32_t v = descend(k, rank, path);
+        size_t c = count_le(m_leaves[v].keys, m_leaves[v].num, k);
+
+        if(!c) {
+            // all keys in the leaf are greater than x, but a run of duplicates
+            // may still end in the previous leaf
+            const uint32_t w = prev_leaf(path);
+            assert(w == m_leaves[v].prev);
+            if(w == NONE) return false;
+            v = w;
+            c = m_leaves[v].num;
+        }
+
+        leaf& l = m_leaves[v];
+        if(l.keys[c-1] != k) return false;
+
+        std::copy(l.keys + c, l.keys + l.num, l.keys + c - 1);
+        --l.num;
+        --m_size;
+
+        for(size_t h = 0; h < m_height; h++) {
+            --m_inner[path[h].node].sizes[path[h].child];
+        }
+
+        if(l.num == 0 && m_num_leaves > 1) {
+            // remove the leaf
+            if(l.prev != NONE) m_leaves[l.prev].next = l.next; else m_head = l.next;
+            if(l.next != NONE) m_leaves[l.next].prev = l.prev;
+            m_free_leaves.push_back(v);
+            --m_num_leaves;
+            remove_child(m_height, path);
+
+            // shrink the root while it has a single child
+            while(m_height > 0 && m_inner[m_root].num == 1) {
+                m_free_inner.push_back(m_root);
+                m_root = m_inner[m_root].children[0];
+                --m_height;
+            }
+        }
+
+        if(unlikely(4 * m_size < m_num_leaves * m_leaf_cap && m_num_leaves > 1)) {
+            rebuild();
+        }
+        return true;
+    }
+
+    inline value_result<item_t> predecessor(const item_t x) const {
+        const key_t k = key_t(x);
+
+        step path[m_max_height];
+        size_t rank;
+        const leaf& l = m_leaves[descend(k, rank, path)];
+
+        const size_t c = count_le(l.keys, l.num, k);
+        if(c) return value_result<item_t> { true, rank + c - 1, item_t(l.keys[c-1]) };
+
+        // all keys in the leaf are greater than x (or it is empty),
+        // so the predecessor is the last key of the previous leaf
+        if(l.prev == NONE) return value_result<item_t> { false, 0, item_t() };
+
+        const leaf& p = m_leaves[l.prev];
+        return value_result<item_t> { true, rank - 1, item_t(p.keys[p.num-1]) };
+    }
+
+    inline value_result<item_t> successor(const item_t x) const {
+        const key_t k = key_t(x);
+        if(unlikely(k == key_t())) {
+            // the successor is the minimum
+            const leaf& l = m_leaves[m_head];
+            if(l.num) return value_result<item_t> { true, 0, item_t(l.keys[0]) };
+            else      return value_result<item_t> { false, 0, item_t() };
+        }
+
+        // find the leaf that contains the predecessor of x - 1
+        const key_t k1 = key_t(uint64_t(k) - 1);
+
+        step path[m_max_height];
+        size_t rank;
+        const leaf& l = m_leaves[descend(k1, rank, path)];
+
+        const size_t c = count_le(l.keys, l.num, k1);
+        if(c < l.num) return value_result<item_t> { true, rank + c, item_t(l.keys[c]) };
+
+        // all keys in the leaf are less than x,
+        // so the successor is the first key of the next leaf
+        if(l.next == NONE) return value_result<item_t> { false, 0, item_t() };
+
+        const leaf& n = m_leaves[l.next];
+        return value_result<item_t> { true, rank + l.num, item_t(n.keys[0]) };
+    }
+
+    // tests whether x is contained
+    inline bool contains(const item_t x) const {
+        const auto r = predecessor(x);
+        return r.exists && r.value == x;
+    }
+
+    // the number of keys
+    inline size_t size() const {
+        return m_size;
+    }
+};
+
+}}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stash/pred/result.hpp>
+#include <stash/pred/util.hpp>
+
+#include <stash/civ/elias_fano.hpp>
+#include <stash/io/serialize.hpp>
+
+namespace stash {
+namespace pred {
+
+// stores an Elias-Fano encoded copy of the input, so that the input sequence
+// need not be kept in memory after construction
+//
+// queries report the value of the predecessor or successor
+// in addition to its position (rank) in the input sequence
+template<typename array_t, typename item_t>
+class elias_fano {
+private:
+    civ::elias_fano m_keys;
+
+public:
+    inline elias_fano() {
+    }
+
+    inline elias_fano(const array_t& array) : m_keys(array) {
+    }
+
+    // maps a structure written using write - the array is not needed
+    inline elias_fano(io::mapped_reader& in) : m_keys(in) {
+    }
+
+    inline elias_fano(const array_t&, io::mapped_reader& in) : m_keys(in) {
+    }
+
+    // writes the structure so that it can be mapped into memory later
+    inline void write(io::serializer& out) const {
+        m_keys.write(out);
+    }
+
+    inline value_result<item_t> predecessor(const item_t x) const {
+        const auto r = m_keys.predecessor(uint64_t(x));
+        return value_result<item_t> { r.exists, r.pos, item_t(r.value) };
+    }
+
+    inline value_result<item_t> successor(const item_t x) const {
+        const auto r = m_keys.successor(uint64_t(x));
+        return value_result<item_t> { r.exists, r.pos, item_t(r.value) };
+    }
+
+    // accesses the i-th item of the input sequence
+    inline item_t operator[](const size_t i) const {
+        return item_t(m_keys[i]);
+    }
+
+    inline size_t size() const {
+        return m_keys.size();
+    }
+};
+
+}}
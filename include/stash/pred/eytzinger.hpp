@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <stash/pred/result.hpp>
+#include <stash/pred/util.hpp>
+
+#include <stash/util/math.hpp>
+
+namespace stash {
+namespace pred {
+
+// binary search on a copy of the input stored in BFS order (Eytzinger layout),
+// in which the descendants of a node several levels below are stored
+// contiguously and can thus be prefetched ahead of the search
+template<typename array_t, typename item_t>
+class eytzinger {
+private:
+    // number of keys that fit into a cache line, rounded down to a power of two
+    static constexpr size_t m_line_num = 1ULL << log2_floor(64ULL / sizeof(item_t));
+
+    // whether a group of m_line_num keys fills exactly one cache line - if the
+    // key size is not a power of two (e.g., 40 bits), a group is smaller and
+    // not aligned, so it may span two lines
+    static constexpr bool m_line_aligned = (m_line_num * sizeof(item_t) == 64ULL);
+
+    size_t m_num;
+    item_t m_min;
+    item_t m_max;
+
+    // the number of levels in the implicit tree
+    // and the number of nodes on the last (incomplete) level
+    size_t m_height;
+    size_t m_num_last;
+
+    std::vector<item_t> m_data; // allocated memory
+    item_t*             m_keys; // BFS layout (one-based), m_keys is aligned
+                                // to a cache line
+
+    // prefetches the descendants of node k that are log2(m_line_num) levels
+    // below, which are stored contiguously starting at m_line_num * k
+    inline void prefetch(const size_t k) const {
+        const item_t* group = m_keys + m_line_num * k;
+        __builtin_prefetch(group);
+        if constexpr(!m_line_aligned) {
+            __builtin_prefetch((const char*)(group + m_line_num) - 1); // last byte of the group
+        }
+    }
+
+    inline size_t build(const array_t& array, size_t i, const size_t k) {
+        if(k <= m_num) {
+            i = build(array, i, 2 * k);
+            m_keys[k] = array[i++];
+            i = build(array, i, 2 * k + 1);
+        }
+        return i;
+    }
+
+    // computes the position in the input of the BFS node k
+    inline size_t position(const size_t k) const {
+        assert(k > 0 && k <= m_num);
+
+        // in-order rank of k if the tree were perfect
+        const size_t d = log2_floor(k);
+        const size_t r = ((((k ^ (1ULL << d)) << 1ULL) + 1ULL) << (m_height - 1 - d)) - 1;
+
+        // subtract the nodes missing on the last level left of k,
+        // which have ranks 0, 2, 4, ... in the perfect tree
+        const size_t missing_left = idiv_ceil(r, 2);
+        return r - (missing_left > m_num_last ? missing_left - m_num_last : 0);
+    }
+
+public:
+    inline eytzinger(const array_t& array)
+        : m_num(array.size()),
+          m_min(array[0]),
+          m_max(array[m_num-1]) {
+
+        assert_sorted_ascending(array);
+
+        m_height = log2_floor(m_num) + 1;
+        m_num_last = m_num - ((1ULL << (m_height - 1)) - 1);
+
+        // allocate so that index 0 is aligned to a cache line
+        m_data.resize(m_num + 1 + idiv_ceil(64ULL, sizeof(item_t)));
+        const uintptr_t addr = uintptr_t(m_data.data());
+        m_keys = (item_t*)((addr + 63ULL) & ~uintptr_t(63ULL));
+
+        build(array, 0, 1);
+    }
+
+    eytzinger(const eytzinger&) = delete;
+    eytzinger& operator=(const eytzinger&) = delete;
+
+    inline result predecessor(const item_t x) const {
+        if(unlikely(x < m_min))  return result { false, 0 };
+        if(unlikely(x >= m_max)) return result { true, m_num-1 };
+
+        // find the first key greater than x
+        size_t k = 1;
+        while(k <= m_num) {
+            prefetch(k);
+            k = 2 * k + (m_keys[k] <= x);
+        }
+
+        // strip the trailing right turns and the last left turn
+        // to get the node at which the search last turned left
+        k >>= __builtin_ffsll(~k);
+        assert(k > 0); // exists because x < m_max
+
+        return result { true, position(k) - 1 };
+    }
+
+    inline result successor(const item_t x) const {
+        if(unlikely(x <= m_min)) return result { true, 0 };
+        if(unlikely(x > m_max))  return result { false, 0 };
+
+        // find the first key greater than or equal to x
+        size_t k = 1;
+        while(k <= m_num) {
+            prefetch(k);
+            k = 2 * k + (m_keys[k] < x);
+        }
+
+        // strip the trailing right turns and the last left turn
+        // to get the node at which the search last turned left
+        k >>= __builtin_ffsll(~k);
+        assert(k > 0); // exists because x <= m_max
+
+        return result { true, position(k) };
+    }
+};
+
+}}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include <stash/pred/result.hpp>
+#include <stash/pred/search.hpp>
+#include <stash/util/likely.hpp>
+
+namespace stash {
+namespace pred {
+
+// finger search on top of any predecessor structure for a stream of queries
+// with locality, e.g., sorted or nearly sorted queries
+//
+// the finger is the position of the previous result - a query gallops
+// (exponential search) from there towards x in either direction, and falls
+// back to the underlying structure if x is more than 2^m_max_steps items away,
+// so a scan over sorted queries costs O(log d) probes for a distance d
+//
+// if the structure provides access to the items (operator[], e.g.,
+// elias_fano), galloping probes the structure, so that the finger works on its
+// encoding rather than the plain array, and queries also report the value -
+// otherwise, galloping probes the array
+//
+// a finger is a cheap cursor that is not shared between threads, and the
+// underlying structure and array must outlive it
+template<typename pred_t, typename array_t, typename item_t, size_t m_max_steps = 8>
+class finger {
+private:
+    // tests whether the structure provides access to the items
+    template<typename T, typename = void>
+    struct has_access : std::false_type {};
+
+    template<typename T>
+    struct has_access<T, std::void_t<decltype(std::declval<const T&>()[size_t(0)])>> : std::true_type {};
+
+    static constexpr bool m_access = has_access<pred_t>::value;
+
+    using result_t = std::conditional_t<m_access, value_result<item_t>, result>;
+
+    const pred_t* m_pred;
+    const array_t* m_array;
+    size_t m_num;
+    size_t m_pos;
+    bool m_valid;
+
+    inline item_t at(const size_t i) const {
+        if constexpr(m_access) {
+            return item_t((*m_pred)[i]);
+        } else {
+            return (*m_array)[i];
+        }
+    }
+
+    static inline result_t make_result(const bool exists, const size_t pos, const item_t value) {
+        if constexpr(m_access) {
+            return result_t { exists, pos, value };
+        } else {
+            return result_t { exists, pos };
+        }
+    }
+
+    // finds the last position p for which test<m_le>(at(p), x) holds by
+    // galloping from the finger - returns false if that takes more than
+    // m_max_steps steps, otherwise sets p and q = p + 1 along with the items
+    // at these positions, where p = m_num means that there is no such
+    // position and q = m_num that q is past the end (vp or vq are undefined)
+    template<bool m_le>
+    inline bool gallop(const item_t x, size_t& p, size_t& q, item_t& vp, item_t& vq) const {
+        size_t step = 1;
+        const item_t v = at(m_pos);
+        if(search::test<m_le>(v, x)) {
+            p = m_pos;
+            vp = v;
+            for(size_t s = 0;; s++) {
+                if(s == m_max_steps) return false;
+                q = p + step;
+                if(q >= m_num) {
+                    q = m_num;
+                    break;
+                }
+                vq = at(q);
+                if(!search::test<m_le>(vq, x)) break;
+                p = q;
+                vp = vq;
+                step <<= 1;
+            }
+        } else {
+            q = m_pos;
+            vq = v;
+            for(size_t s = 0;; s++) {
+                if(q == 0) {
+                    p = m_num;
+                    return true;
+                }
+                if(s == m_max_steps) return false;
+                p = (q > step) ? q - step : 0;
+                vp = at(p);
+                if(search::test<m_le>(vp, x)) break;
+                q = p;
+                vq = vp;
+                step <<= 1;
+            }
+        }
+
+        // binary search between the last two probes
+        while(q - p > 1) {
+            const size_t m = (p + q) >> 1ULL;
+            const item_t vm = at(m);
+            if(search::test<m_le>(vm, x)) {
+                p = m;
+                vp = vm;
+            } else {
+                q = m;
+                vq = vm;
+            }
+        }
+        return true;
+    }
+
+public:
+    inline finger(const pred_t& pred, const array_t& array)
+        : m_pred(&pred),
+          m_array(&array),
+          m_num(array.size()),
+          m_pos(0),
+          m_valid(false) {
+    }
+
+    // forgets the finger, so the next query is answered by the structure
+    inline void reset() {
+        m_valid = false;
+    }
+
+    inline result_t predecessor(const item_t x) {
+        if(likely(m_valid)) {
+            size_t p, q;
+            item_t vp, vq;
+            if(gallop<true>(x, p, q, vp, vq)) {
+                if(p == m_num) return make_result(false, 0, item_t());
+                m_pos = p;
+                return make_result(true, p, vp);
+            }
+        }
+
+        const result_t r = m_pred->predecessor(x);
+        if(r.exists) {
+            m_pos = r.pos;
+            m_valid = true;
+        }
+        return r;
+    }
+
+    inline result_t successor(const item_t x) {
+        if(likely(m_valid)) {
+            size_t p, q;
+            item_t vp, vq;
+            if(gallop<false>(x, p, q, vp, vq)) {
+                // q is the first position of an item not less than x
+                if(q == m_num) return make_result(false, 0, item_t());
+                m_pos = q;
+                return make_result(true, q, vq);
+            }
+        }
+
+        const result_t r = m_pred->successor(x);
+        if(r.exists) {
+            m_pos = r.pos;
+            m_valid = true;
+        }
+        return r;
+    }
+};
+
+}}
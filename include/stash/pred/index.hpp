@@ -8,6 +8,8 @@
 
 #include <stash/pred/binsearch_cache.hpp>
 
+#include <stash/io/serialize.hpp>
+
 #include <stash/vec/int_vector.hpp>
 #include <stash/util/math.hpp>
 
@@ -18,7 +20,8 @@ template<
     typename array_t,
     typename item_t,
     size_t m_lo_bits,
-    size_t m_cache_num = 512ULL / sizeof(item_t)>
+    size_t m_cache_num = 512ULL / sizeof(item_t),
+    typename search_t = search::bisection>
 class index {
 private:
     static constexpr size_t m_hi_bits = 8 * sizeof(item_t) - m_lo_bits;
@@ -37,7 +40,7 @@ private:
 
     int_vector m_hi_idx;
 
-    using lo_pred_t = binsearch_cache<array_t, item_t, m_cache_num>;
+    using lo_pred_t = binsearch_cache<array_t, item_t, m_cache_num, search_t>;
     lo_pred_t m_lo_pred;
 
 public:
@@ -52,7 +55,8 @@ public:
         *this = std::move(other);
     }
 
-    inline index(const array_t& array)
+    // constructs the index using the given number of threads
+    inline index(const array_t& array, const size_t num_threads = 1)
         : m_num(array.size()),
           m_min(array[0]),
           m_max(array[m_num-1]),
@@ -64,26 +68,42 @@ public:
         m_key_min = uint64_t(m_min) >> m_lo_bits;
         m_key_max = uint64_t(m_max) >> m_lo_bits;
 
-        m_hi_idx = int_vector(m_key_max - m_key_min + 2, log2_ceil(m_num-1));
-        m_hi_idx[0] = 0;
-        uint64_t prev_key = m_key_min;
-        for(size_t i = 1; i < m_num; i++) {
-            const uint64_t cur_key = hi(array[i]);
-            if(cur_key > prev_key) {
-                for(uint64_t key = prev_key + 1; key <= cur_key; key++) {
-                    m_hi_idx[key - m_key_min] = i - 1;
-                }
-            }
-            prev_key = cur_key;
-        }
-
-        assert(prev_key == m_key_max);
-        m_hi_idx[m_key_max - m_key_min] = m_num - 1;
+        // threads write slices of 64 entries, which start at word borders
+        const size_t num_keys = m_key_max - m_key_min + 2;
+        m_hi_idx = int_vector(num_keys, log2_ceil(m_num-1));
+        fill_hi_idx(array, m_lo_bits, m_key_min, m_hi_idx, num_keys, num_threads, 64);
+        assert(m_hi_idx[num_keys - 1] == m_num - 1);
 
         // build the predecessor data structure for low bits
         m_lo_pred = lo_pred_t(array);
     }
 
+    // maps an index written using write for the given array
+    inline index(const array_t& array, io::mapped_reader& in)
+        : m_num(array.size()),
+          m_min(array[0]),
+          m_max(array[m_num-1]),
+          m_array(&array) {
+
+        in.expect(m_lo_bits);
+        in.expect(sizeof(item_t));
+        in.expect(m_num);
+        m_key_min = in.read();
+        m_key_max = in.read();
+        m_hi_idx = int_vector(in);
+        m_lo_pred = lo_pred_t(array);
+    }
+
+    // writes the index (not the array) so that it can be mapped into memory later
+    inline void write(io::serializer& out) const {
+        out.write(m_lo_bits);
+        out.write(sizeof(item_t));
+        out.write(m_num);
+        out.write(m_key_min);
+        out.write(m_key_max);
+        m_hi_idx.write(out);
+    }
+
     inline index& operator=(const index& other) {
         m_array = other.m_array;
         m_num = other.m_num;
@@ -138,6 +158,67 @@ public:
             return m_lo_pred.successor_seeded(x, p, q);
         }
     }
+
+    // answers n predecessor queries, interleaving BATCH_SIZE queries at a
+    // time and prefetching their interval borders before searching them
+    inline void predecessor_batch(const item_t* xs, const size_t n, result* out) const {
+        query_group<item_t> g;
+        for(size_t i = 0; i < n; i += BATCH_SIZE) {
+            const size_t end = std::min(i + BATCH_SIZE, n);
+
+            g.num = 0;
+            for(size_t j = i; j < end; j++) {
+                const item_t x = xs[j];
+                if(unlikely(x < m_min))       out[j] = result { false, 0 };
+                else if(unlikely(x >= m_max)) out[j] = result { true, m_num-1 };
+                else {
+                    const uint64_t key = hi(x) - m_key_min;
+                    m_hi_idx.prefetch(key);
+                    g.p[g.num] = key;
+                    g.add(x, j);
+                }
+            }
+
+            for(size_t k = 0; k < g.num; k++) {
+                const uint64_t key = g.p[k];
+                g.p[k] = m_hi_idx[key];
+                g.q[k] = m_hi_idx[key+1];
+            }
+
+            m_lo_pred.predecessor_seeded_batch(g, out);
+        }
+    }
+
+    // answers n successor queries, interleaving BATCH_SIZE queries at a
+    // time and prefetching their interval borders before searching them
+    inline void successor_batch(const item_t* xs, const size_t n, result* out) const {
+        query_group<item_t> g;
+        for(size_t i = 0; i < n; i += BATCH_SIZE) {
+            const size_t end = std::min(i + BATCH_SIZE, n);
+
+            g.num = 0;
+            for(size_t j = i; j < end; j++) {
+                const item_t x = xs[j];
+                if(unlikely(x <= m_min))     out[j] = result { true, 0 };
+                else if(unlikely(x > m_max)) out[j] = result { false, 0 };
+                else {
+                    const uint64_t key = hi(x) - m_key_min;
+                    m_hi_idx.prefetch(key);
+                    g.p[g.num] = key;
+                    g.add(x, j);
+                }
+            }
+
+            for(size_t k = 0; k < g.num; k++) {
+                const uint64_t key = g.p[k];
+                const size_t _q = m_hi_idx[key+1] + 1;
+                g.p[k] = m_hi_idx[key] + 1;
+                g.q[k] = _q - (_q >= m_num); // std::min(_q, m_num - 1);
+            }
+
+            m_lo_pred.successor_seeded_batch(g, out);
+        }
+    }
 };
 
 }}
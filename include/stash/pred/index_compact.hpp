@@ -7,17 +7,24 @@
 
 #include <stash/pred/binsearch_cache.hpp>
 
+#include <stash/io/serialize.hpp>
+
+#include <stash/civ/elias_fano.hpp>
 #include <stash/civ/unary_sorted_sequence.hpp>
 #include <stash/util/math.hpp>
 
 namespace stash {
 namespace pred {
 
+// hi_idx_t is the compressed sequence type used to store the interval borders,
+// e.g., civ::unary_sorted_sequence or civ::elias_fano
 template<
     typename array_t,
     typename item_t,
     size_t m_lo_bits,
-    size_t m_cache_num = 512ULL / sizeof(item_t)>
+    size_t m_cache_num = 512ULL / sizeof(item_t),
+    typename hi_idx_t = civ::unary_sorted_sequence,
+    typename search_t = search::bisection>
 class index_compact {
 private:
     static constexpr size_t m_hi_bits = 8 * sizeof(item_t) - m_lo_bits;
@@ -34,13 +41,15 @@ private:
     uint64_t m_key_min;
     uint64_t m_key_max;
 
-    civ::unary_sorted_sequence m_hi_idx;
+    hi_idx_t m_hi_idx;
 
-    using lo_pred_t = binsearch_cache<array_t, item_t, m_cache_num>;
+    using lo_pred_t = binsearch_cache<array_t, item_t, m_cache_num, search_t>;
     lo_pred_t m_lo_pred;
 
 public:
-    inline index_compact(const array_t& array)
+    // constructs the index using the given number of threads
+    // (only the interval borders are computed in parallel, not their encoding)
+    inline index_compact(const array_t& array, const size_t num_threads = 1)
         : m_num(array.size()),
           m_min(array[0]),
           m_max(array[m_num-1]),
@@ -52,30 +61,44 @@ public:
         m_key_min = uint64_t(m_min) >> m_lo_bits;
         m_key_max = uint64_t(m_max) >> m_lo_bits;
 
-        std::vector<size_t> idx;
-        idx.reserve(m_key_max - m_key_min + 2);
-        idx.emplace_back(0);
+        // slice borders are aligned to cache lines to avoid false sharing
+        const size_t num_keys = m_key_max - m_key_min + 2;
+        std::vector<size_t> idx(num_keys);
+        fill_hi_idx(array, m_lo_bits, m_key_min, idx, num_keys, num_threads, 8);
+        assert(idx[num_keys - 1] == m_num - 1);
 
-        uint64_t prev_key = m_key_min;
-        for(size_t i = 1; i < m_num; i++) {
-            const uint64_t cur_key = hi(array[i]);
-            if(cur_key > prev_key) {
-                for(uint64_t key = prev_key + 1; key <= cur_key; key++) {
-                    idx.emplace_back(i-1);
-                }
-            }
-            prev_key = cur_key;
-        }
+        m_hi_idx = hi_idx_t(idx);
 
-        assert(prev_key == m_key_max);
-        idx.emplace_back(m_num - 1);
+        // build the predecessor data structure for low bits
+        m_lo_pred = lo_pred_t(array);
+    }
 
-        m_hi_idx = civ::unary_sorted_sequence(idx);
+    // maps an index written using write for the given array
+    inline index_compact(const array_t& array, io::mapped_reader& in)
+        : m_num(array.size()),
+          m_min(array[0]),
+          m_max(array[m_num-1]),
+          m_array(&array) {
 
-        // build the predecessor data structure for low bits
+        in.expect(m_lo_bits);
+        in.expect(sizeof(item_t));
+        in.expect(m_num);
+        m_key_min = in.read();
+        m_key_max = in.read();
+        m_hi_idx = hi_idx_t(in);
         m_lo_pred = lo_pred_t(array);
     }
 
+    // writes the index (not the array) so that it can be mapped into memory later
+    inline void write(io::serializer& out) const {
+        out.write(m_lo_bits);
+        out.write(sizeof(item_t));
+        out.write(m_num);
+        out.write(m_key_min);
+        out.write(m_key_max);
+        m_hi_idx.write(out);
+    }
+
     inline result predecessor(const item_t x) const {
         if(unlikely(x < m_min))  return result { false, 0 };
         if(unlikely(x >= m_max)) return result { true, m_num-1 };
@@ -106,6 +129,67 @@ public:
             return m_lo_pred.successor_seeded(x, p, q);
         }
     }
+
+    // answers n predecessor queries, interleaving BATCH_SIZE queries at a
+    // time and prefetching their interval borders before searching them
+    inline void predecessor_batch(const item_t* xs, const size_t n, result* out) const {
+        query_group<item_t> g;
+        for(size_t i = 0; i < n; i += BATCH_SIZE) {
+            const size_t end = std::min(i + BATCH_SIZE, n);
+
+            g.num = 0;
+            for(size_t j = i; j < end; j++) {
+                const item_t x = xs[j];
+                if(unlikely(x < m_min))       out[j] = result { false, 0 };
+                else if(unlikely(x >= m_max)) out[j] = result { true, m_num-1 };
+                else {
+                    const uint64_t key = hi(x) - m_key_min;
+                    m_hi_idx.prefetch(key);
+                    g.p[g.num] = key;
+                    g.add(x, j);
+                }
+            }
+
+            for(size_t k = 0; k < g.num; k++) {
+                const uint64_t key = g.p[k];
+                g.p[k] = m_hi_idx[key];
+                g.q[k] = m_hi_idx[key+1];
+            }
+
+            m_lo_pred.predecessor_seeded_batch(g, out);
+        }
+    }
+
+    // answers n successor queries, interleaving BATCH_SIZE queries at a
+    // time and prefetching their interval borders before searching them
+    inline void successor_batch(const item_t* xs, const size_t n, result* out) const {
+        query_group<item_t> g;
+        for(size_t i = 0; i < n; i += BATCH_SIZE) {
+            const size_t end = std::min(i + BATCH_SIZE, n);
+
+            g.num = 0;
+            for(size_t j = i; j < end; j++) {
+                const item_t x = xs[j];
+                if(unlikely(x <= m_min))     out[j] = result { true, 0 };
+                else if(unlikely(x > m_max)) out[j] = result { false, 0 };
+                else {
+                    const uint64_t key = hi(x) - m_key_min;
+                    m_hi_idx.prefetch(key);
+                    g.p[g.num] = key;
+                    g.add(x, j);
+                }
+            }
+
+            for(size_t k = 0; k < g.num; k++) {
+                const uint64_t key = g.p[k];
+                const size_t _q = m_hi_idx[key+1] + 1;
+                g.p[k] = m_hi_idx[key] + 1;
+                g.q[k] = _q - (_q >= m_num); // std::min(_q, m_num - 1);
+            }
+
+            m_lo_pred.successor_seeded_batch(g, out);
+        }
+    }
 };
 
 }}
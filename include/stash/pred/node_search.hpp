@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+
+#include <stash/util/cpu.hpp>
+
+namespace stash {
+namespace pred {
+
+// the smallest unsigned integer type that can hold the given number of bits
+template<size_t m_bits>
+using node_key_t =
+    std::conditional_t<(m_bits <= 8),  uint8_t,
+    std::conditional_t<(m_bits <= 16), uint16_t,
+    std::conditional_t<(m_bits <= 32), uint32_t,
+                                       uint64_t>>>;
+
+// searching sorted, unpacked key arrays within a cache line
+template<typename key_t>
+struct node_search {
+    static_assert(std::is_unsigned<key_t>::value, "keys must be unsigned integers");
+
+    // number of keys that are compared in one go (one cache line)
+    static constexpr size_t width = 64ULL / sizeof(key_t);
+
+    // counts the keys that are less than or equal to x
+    // among the first n (at most width) keys in the given array
+    //
+    // SIMD compares are inlined if the build targets AVX-512BW or AVX2,
+    // otherwise the kernel is selected at runtime (see cpu.hpp)
+    //
+    // NOTE: the array must be readable up to keys + width,
+    //       keys beyond n are ignored
+    static inline size_t count_le(const key_t* keys, const size_t n, const key_t x) {
+        assert(n <= width);
+        #ifdef __AVX512BW__
+        return count_le_avx512(keys, n, x);
+        #elif defined(__AVX2__)
+        return count_le_avx2(keys, n, x);
+        #else
+        #ifdef STASH_X86
+        if(cpu::has_avx512bw()) return count_le_avx512(keys, n, x);
+        if(cpu::has_avx2()) return count_le_avx2(keys, n, x);
+        #endif
+        return count_le_scalar(keys, n, x);
+        #endif
+    }
+
+    // the name of the kernel used by count_le
+    static inline const char* kernel() {
+        #ifdef __AVX512BW__
+        return "avx512";
+        #elif defined(__AVX2__)
+        return "avx2";
+        #else
+        #ifdef STASH_X86
+        if(cpu::has_avx512bw()) return "avx512";
+        if(cpu::has_avx2()) return "avx2";
+        #endif
+        return "scalar";
+        #endif
+    }
+
+    // counts the keys that are less than or equal to x in the given array
+    //
+    // NOTE: the array must be readable up to keys + n + width
+    static inline size_t rank_le(const key_t* keys, size_t n, const key_t x) {
+        const key_t* base = keys;
+
+        // narrow down to a single cache line using branchless binary search
+        while(n > width) {
+            const size_t half = n >> 1ULL;
+            base = (base[half] <= x) ? base + half : base;
+            n -= half;
+        }
+
+        return size_t(base - keys) + count_le(base, n, x);
+    }
+
+private:
+    static inline size_t count_le_scalar(const key_t* keys, const size_t n, const key_t x) {
+        size_t c = 0;
+        for(size_t i = 0; i < n; i++) {
+            c += (keys[i] <= x);
+        }
+        return c;
+    }
+
+    #ifdef STASH_X86
+    STASH_TARGET("avx512f,avx512bw")
+    static inline size_t count_le_avx512(const key_t* keys, const size_t n, const key_t x) {
+        // one compare yields one mask bit per key
+        const uint64_t m = cmp_le_mask512(_mm512_loadu_si512(keys), x);
+        const uint64_t n_mask = (n == width) ? UINT64_MAX : ((1ULL << n) - 1ULL);
+        return __builtin_popcountll(m & n_mask);
+    }
+
+    STASH_TARGET("avx2")
+    static inline size_t count_le_avx2(const key_t* keys, const size_t n, const key_t x) {
+        const __m256i* v = (const __m256i*)keys;
+        const uint64_t m = uint64_t(cmp_le_mask(_mm256_loadu_si256(v), x)) |
+                           (uint64_t(cmp_le_mask(_mm256_loadu_si256(v + 1), x)) << 32ULL);
+
+        // each key yields sizeof(key_t) bits in the mask
+        const uint64_t n_mask = (n == width) ? UINT64_MAX : ((1ULL << (n * sizeof(key_t))) - 1ULL);
+        return __builtin_popcountll(m & n_mask) / sizeof(key_t);
+    }
+
+    // compare mask of the keys in v that are less than or equal to x
+    STASH_TARGET("avx512f,avx512bw")
+    static inline uint64_t cmp_le_mask512(const __m512i v, const key_t x) {
+        if constexpr(sizeof(key_t) == 1) {
+            return _mm512_cmple_epu8_mask(v, _mm512_set1_epi8(x));
+        } else if constexpr(sizeof(key_t) == 2) {
+            return _mm512_cmple_epu16_mask(v, _mm512_set1_epi16(x));
+        } else if constexpr(sizeof(key_t) == 4) {
+            return _mm512_cmple_epu32_mask(v, _mm512_set1_epi32(x));
+        } else {
+            return _mm512_cmple_epu64_mask(v, _mm512_set1_epi64(x));
+        }
+    }
+
+    // movemask of the keys in v that are less than or equal to x
+    STASH_TARGET("avx2")
+    static inline uint32_t cmp_le_mask(const __m256i v, const key_t x) {
+        if constexpr(sizeof(key_t) == 1) {
+            const __m256i vx = _mm256_set1_epi8(x);
+            return _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(v, vx), vx));
+        } else if constexpr(sizeof(key_t) == 2) {
+            const __m256i vx = _mm256_set1_epi16(x);
+            return _mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_max_epu16(v, vx), vx));
+        } else if constexpr(sizeof(key_t) == 4) {
+            const __m256i vx = _mm256_set1_epi32(x);
+            return _mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_max_epu32(v, vx), vx));
+        } else {
+            // there is no unsigned 64-bit compare in AVX2, flip the sign bits
+            const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+            const __m256i vx = _mm256_set1_epi64x(int64_t(uint64_t(x) ^ uint64_t(INT64_MIN)));
+            return ~uint32_t(_mm256_movemask_epi8(_mm256_cmpgt_epi64(_mm256_xor_si256(v, sign), vx)));
+        }
+    }
+    #endif
+};
+
+}}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include <stash/pred/result.hpp>
+#include <stash/pred/util.hpp>
+
+#include <stash/pred/binsearch_cache.hpp>
+
+namespace stash {
+namespace pred {
+
+// learned index in the style of the PGM-index: the positions of the items
+// are approximated by linear segments with a maximum error of m_epsilon,
+// and the segments are indexed recursively the same way using a maximum
+// error of m_epsilon_rec until a single segment remains
+//
+// queries follow the predicted positions down the levels and finish with a
+// binary search in a window of size 2 * m_epsilon around the prediction
+template<
+    typename array_t,
+    typename item_t,
+    size_t m_epsilon = 64,
+    size_t m_epsilon_rec = 4,
+    size_t m_cache_num = 512ULL / sizeof(item_t),
+    typename search_t = search::bisection>
+class pgm {
+private:
+    static_assert(m_epsilon > 0 && m_epsilon_rec > 0, "the maximum errors must be positive");
+
+    struct segment {
+        uint64_t key;       // first key covered by the segment
+        double   slope;
+        size_t   intercept; // position of key
+    };
+
+    // predicts the position of x, which must be covered by the segment
+    static inline size_t predict(const segment& s, const uint64_t x) {
+        return s.intercept + size_t(s.slope * double(x - s.key));
+    }
+
+    // computes error-bounded segments for the given sorted keys
+    // using the shrinking cone algorithm - only the first occurrence
+    // of duplicate keys is considered
+    template<typename keys_t>
+    static std::vector<segment> build_segments(const keys_t& keys, const size_t num, const double eps) {
+        std::vector<segment> segments;
+
+        size_t i = 0;
+        while(i < num) {
+            const uint64_t key = uint64_t(keys[i]);
+            double slope_lo = 0.0;
+            double slope_hi = std::numeric_limits<double>::infinity();
+
+            size_t j = i + 1;
+            for(; j < num; j++) {
+                const uint64_t x = uint64_t(keys[j]);
+                if(x == uint64_t(keys[j-1])) continue; // duplicate
+
+                // the slopes for which the error at j stays within eps
+                const double dx = double(x - key);
+                const double dy = double(j - i);
+                const double lo = (dy - eps) / dx;
+                const double hi = (dy + eps) / dx;
+
+                if(lo > slope_hi || hi < slope_lo) break; // cone is empty
+
+                slope_lo = std::max(slope_lo, lo);
+                slope_hi = std::min(slope_hi, hi);
+            }
+
+            const double slope = (slope_hi == std::numeric_limits<double>::infinity())
+                ? slope_lo : 0.5 * (slope_lo + slope_hi);
+
+            segments.push_back(segment { key, slope, i });
+            i = j;
+        }
+
+        return segments;
+    }
+
+    const array_t* m_array;
+    size_t m_num;
+    item_t m_min;
+    item_t m_max;
+
+    // segment levels, the last one contains a single segment
+    std::vector<std::vector<segment>> m_levels;
+
+    using lo_pred_t = binsearch_cache<array_t, item_t, m_cache_num, search_t>;
+    lo_pred_t m_lo_pred;
+
+    // finds the segment of the bottom level that covers x
+    inline const segment& find_segment(const uint64_t x) const {
+        size_t s = 0;
+        for(size_t l = m_levels.size() - 1; l > 0; l--) {
+            const auto& lower = m_levels[l-1];
+
+            // predict, then correct by linear search
+            s = std::min(predict(m_levels[l][s], x), lower.size() - 1);
+            while(s > 0 && lower[s].key > x) --s;
+            while(s + 1 < lower.size() && lower[s+1].key <= x) ++s;
+        }
+        return m_levels[0][s];
+    }
+
+public:
+    inline pgm(const array_t& array)
+        : m_array(&array),
+          m_num(array.size()),
+          m_min(array[0]),
+          m_max(array[m_num-1]) {
+
+        assert_sorted_ascending(array);
+
+        // index access to the keys of a segment level
+        struct level_keys {
+            const std::vector<segment>* segments;
+            inline uint64_t operator[](const size_t i) const { return (*segments)[i].key; }
+        };
+
+        m_levels.emplace_back(build_segments(array, m_num, double(m_epsilon)));
+        while(m_levels.back().size() > 1) {
+            const auto& level = m_levels.back();
+            auto segments = build_segments(level_keys { &level }, level.size(), double(m_epsilon_rec));
+            m_levels.emplace_back(std::move(segments));
+        }
+
+        for(auto& level : m_levels) level.shrink_to_fit();
+        m_lo_pred = lo_pred_t(array);
+    }
+
+    inline result predecessor(const item_t x) const {
+        if(unlikely(x < m_min))  return result { false, 0 };
+        if(unlikely(x >= m_max)) return result { true, m_num-1 };
+
+        const size_t pos = std::min(predict(find_segment(x), x), m_num - 1);
+
+        // search window - must satisfy array[p] <= x < array[q],
+        // which is guaranteed for distinct keys and otherwise ensured by galloping
+        size_t p = pos - std::min(pos, m_epsilon + 1);
+        size_t q = std::min(pos + m_epsilon + 1, m_num - 1);
+        for(size_t d = m_epsilon; (*m_array)[p] > x; d <<= 1ULL) p -= std::min(p, d);
+        for(size_t d = m_epsilon; (*m_array)[q] <= x; d <<= 1ULL) q = std::min(q + d, m_num - 1);
+
+        return m_lo_pred.predecessor_seeded(x, p, q);
+    }
+
+    inline result successor(const item_t x) const {
+        if(unlikely(x <= m_min)) return result { true, 0 };
+        if(unlikely(x > m_max))  return result { false, 0 };
+
+        const size_t pos = std::min(predict(find_segment(x), x), m_num - 1);
+
+        // search window - must satisfy array[p] < x <= array[q]
+        size_t p = pos - std::min(pos, m_epsilon + 1);
+        size_t q = std::min(pos + m_epsilon + 1, m_num - 1);
+        for(size_t d = m_epsilon; (*m_array)[p] >= x; d <<= 1ULL) p -= std::min(p, d);
+        for(size_t d = m_epsilon; (*m_array)[q] < x; d <<= 1ULL) q = std::min(q + d, m_num - 1);
+
+        return m_lo_pred.successor_seeded(x, p, q);
+    }
+};
+
+}}
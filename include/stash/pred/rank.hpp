@@ -1,16 +1,24 @@
 #pragma once
 
+#include <algorithm>
+#include <memory>
+
 #include <stash/vec/bit_vector.hpp>
 #include <stash/vec/bit_rank.hpp>
+#include <stash/vec/bit_rank_interleaved.hpp>
 #include <stash/vec/bit_select.hpp>
 
 #include <stash/pred/util.hpp>
 #include <stash/pred/result.hpp>
 
+#include <stash/io/serialize.hpp>
+
 namespace stash {
 namespace pred {
 
-template<typename array_t, typename item_t>
+// rank_t is the rank support, e.g., bit_rank or bit_rank_interleaved - if it
+// stores the bits itself, the bit vector is discarded after construction
+template<typename array_t, typename item_t, typename rank_t = bit_rank>
 class rank {
 private:
     const array_t* m_array;
@@ -19,7 +27,7 @@ private:
     item_t      m_max;
     
     std::shared_ptr<bit_vector> m_bv;
-    bit_rank                    m_rank;
+    rank_t                      m_rank;
 
 public:
     inline rank(const array_t& array)
@@ -38,7 +46,31 @@ public:
         assert((*m_bv)[0] == 1);
         assert((*m_bv)[m_max-m_min] == 1);
 
-        m_rank = bit_rank(m_bv);
+        m_rank = rank_t(m_bv);
+        if constexpr(rank_t::stores_bits) m_bv.reset();
+    }
+
+    // maps a structure written using write for the given array
+    inline rank(const array_t& array, io::mapped_reader& in)
+        : m_array(&array),
+          m_num(array.size()),
+          m_min(array[0]),
+          m_max(array[m_num-1]) {
+
+        in.expect(sizeof(item_t));
+        in.expect(m_num);
+        in.expect(rank_t::stores_bits);
+        if constexpr(!rank_t::stores_bits) m_bv = std::make_shared<bit_vector>(in);
+        m_rank = rank_t(m_bv, in);
+    }
+
+    // writes the structure (not the array) so that it can be mapped into memory later
+    inline void write(io::serializer& out) const {
+        out.write(sizeof(item_t));
+        out.write(m_num);
+        out.write(rank_t::stores_bits);
+        if constexpr(!rank_t::stores_bits) m_bv->write(out);
+        m_rank.write(out);
     }
 
     inline result predecessor(item_t x) const {
@@ -58,6 +90,64 @@ public:
         assert(p > 0);
         return result { true, p - 1 + (x > (*m_array)[p - 1]) };
     }
+
+    // answers n predecessor queries, prefetching the rank directory
+    // entries for BATCH_SIZE queries at a time
+    inline void predecessor_batch(const item_t* xs, const size_t n, result* out) const {
+        query_group<item_t> g;
+        for(size_t i = 0; i < n; i += BATCH_SIZE) {
+            const size_t end = std::min(i + BATCH_SIZE, n);
+
+            g.num = 0;
+            for(size_t j = i; j < end; j++) {
+                const item_t x = xs[j];
+                if(unlikely(x < m_min))       out[j] = result { false, 0 };
+                else if(unlikely(x >= m_max)) out[j] = result { true, m_num-1 };
+                else {
+                    m_rank.prefetch(x - m_min);
+                    g.add(x, j);
+                }
+            }
+
+            for(size_t k = 0; k < g.num; k++) {
+                const size_t p = m_rank(g.x[k] - m_min);
+                assert(p > 0);
+                out[g.j[k]] = result { true, p - 1 };
+            }
+        }
+    }
+
+    // answers n successor queries, prefetching the rank directory
+    // entries and array entries for BATCH_SIZE queries at a time
+    inline void successor_batch(const item_t* xs, const size_t n, result* out) const {
+        query_group<item_t> g;
+        for(size_t i = 0; i < n; i += BATCH_SIZE) {
+            const size_t end = std::min(i + BATCH_SIZE, n);
+
+            g.num = 0;
+            for(size_t j = i; j < end; j++) {
+                const item_t x = xs[j];
+                if(unlikely(x <= m_min))     out[j] = result { true, 0 };
+                else if(unlikely(x > m_max)) out[j] = result { false, 0 };
+                else {
+                    m_rank.prefetch(x - m_min);
+                    g.add(x, j);
+                }
+            }
+
+            for(size_t k = 0; k < g.num; k++) {
+                const size_t p = m_rank(g.x[k] - m_min);
+                assert(p > 0);
+                prefetch(*m_array, p - 1);
+                g.p[k] = p - 1;
+            }
+
+            for(size_t k = 0; k < g.num; k++) {
+                const size_t p = g.p[k];
+                out[g.j[k]] = result { true, p + (g.x[k] > (*m_array)[p]) };
+            }
+        }
+    }
 };
 
 }}
@@ -16,4 +16,25 @@ struct result {
     }
 };
 
+// result of a query on a structure that stores the keys itself,
+// which additionally reports the value at the reported position
+template<typename item_t>
+struct value_result {
+    bool   exists;
+    size_t pos;
+    item_t value;
+
+    inline operator bool() const {
+        return exists;
+    }
+
+    inline operator size_t() const {
+        return pos;
+    }
+
+    inline operator result() const {
+        return result { exists, pos };
+    }
+};
+
 }}
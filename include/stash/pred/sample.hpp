@@ -16,7 +16,8 @@ template<
     typename array_t,
     typename item_t,
     size_t m_alpha,
-    size_t m_cache_num = 512ULL / sizeof(item_t)>
+    size_t m_cache_num = 512ULL / sizeof(item_t),
+    typename search_t = search::bisection>
 class sample {
 private:
     const array_t* m_array;
@@ -26,10 +27,10 @@ private:
 
     std::vector<item_t> m_sample;
 
-    using idx_pred_t = binsearch_cache<decltype(m_sample), item_t, m_cache_num>;
+    using idx_pred_t = binsearch_cache<decltype(m_sample), item_t, m_cache_num, search_t>;
     idx_pred_t m_idx;
 
-    using pred_t = binsearch_cache<array_t, item_t, m_cache_num>;
+    using pred_t = binsearch_cache<array_t, item_t, m_cache_num, search_t>;
     pred_t m_pred;
 
 public:
@@ -83,6 +84,61 @@ public:
             return m_pred.successor_seeded(x, p, q);
         }
     }
+
+    // answers n predecessor queries, first searching the sample and then
+    // the array for BATCH_SIZE interleaved queries at a time
+    inline void predecessor_batch(const item_t* xs, const size_t n, result* out) const {
+        query_group<item_t> g;
+        result r[BATCH_SIZE];
+        for(size_t i = 0; i < n; i += BATCH_SIZE) {
+            const size_t end = std::min(i + BATCH_SIZE, n);
+
+            g.num = 0;
+            for(size_t j = i; j < end; j++) {
+                const item_t x = xs[j];
+                if(unlikely(x < m_min))       out[j] = result { false, 0 };
+                else if(unlikely(x >= m_max)) out[j] = result { true, m_num-1 };
+                else                          g.add(x, j);
+            }
+
+            m_idx.predecessor_batch(g.x, g.num, r);
+            for(size_t k = 0; k < g.num; k++) {
+                assert(r[k].exists);
+                const size_t p = r[k].pos * m_alpha;
+                g.p[k] = p;
+                g.q[k] = std::min(p + m_alpha, m_num - 1);
+            }
+
+            m_pred.predecessor_seeded_batch(g, out);
+        }
+    }
+
+    // answers n successor queries, first searching the sample and then
+    // the array for BATCH_SIZE interleaved queries at a time
+    inline void successor_batch(const item_t* xs, const size_t n, result* out) const {
+        query_group<item_t> g;
+        result r[BATCH_SIZE];
+        for(size_t i = 0; i < n; i += BATCH_SIZE) {
+            const size_t end = std::min(i + BATCH_SIZE, n);
+
+            g.num = 0;
+            for(size_t j = i; j < end; j++) {
+                const item_t x = xs[j];
+                if(unlikely(x <= m_min))     out[j] = result { true, 0 };
+                else if(unlikely(x > m_max)) out[j] = result { false, 0 };
+                else                         g.add(x, j);
+            }
+
+            m_idx.successor_batch(g.x, g.num, r);
+            for(size_t k = 0; k < g.num; k++) {
+                const size_t q = r[k].exists ? (r[k].pos * m_alpha) : m_num - 1;
+                g.p[k] = (q - m_alpha) & (-(q >= m_alpha)); // std::max(q - m_alpha, 0)
+                g.q[k] = q;
+            }
+
+            m_pred.successor_seeded_batch(g, out);
+        }
+    }
 };
 
 }}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace stash {
+namespace pred {
+
+// search policies for narrowing down a seeded search interval [p, q]
+// in binsearch_cache until it contains at most m_cache_num items
+//
+// m_le selects the predicate: array[i] <= x for predecessor searches
+// and array[i] < x for successor searches - p is only ever moved to positions
+// for which the predicate holds and q only to positions for which it doesn't,
+// so the subsequent linear search starting at p finds the result
+namespace search {
+
+template<bool m_le, typename value_t, typename item_t>
+inline bool test(const value_t& v, const item_t x) {
+    return m_le ? (v <= x) : (v < x);
+}
+
+// does one bisection step on [p, q]
+template<bool m_le, typename array_t, typename item_t>
+inline void bisect(const array_t& array, const item_t x, size_t& p, size_t& q) {
+    const size_t m = (p + q) >> 1ULL;
+
+    /*
+        the following is a fast form of:
+        if(test(array[m], x)) p = m; else q = m;
+    */
+    const size_t t_mask = -size_t(test<m_le>(array[m], x));
+    const size_t f_mask = ~t_mask;
+
+    p = (t_mask & m) | (f_mask & p);
+    q = (f_mask & m) | (t_mask & q);
+}
+
+// interpolates the position of x in [p, q] based on the values at the borders
+// the result is in [p+1, q-1], so probing it always shrinks the interval
+template<typename array_t, typename item_t>
+inline size_t interpolate(const array_t& array, const item_t x, const size_t p, const size_t q) {
+    assert(q - p >= 2);
+
+    const uint64_t lo = uint64_t(array[p]);
+    const uint64_t hi = uint64_t(array[q]);
+    const uint64_t ux = uint64_t(x);
+
+    if(ux <= lo) return p + 1;
+    if(ux >= hi) return q - 1;
+
+    const double f = double(ux - lo) / double(hi - lo);
+    const size_t m = p + size_t(f * double(q - p));
+    return std::min(std::max(m, p + 1), q - 1);
+}
+
+// plain binary search
+struct bisection {
+    template<size_t m_cache_num, bool m_le, typename array_t, typename item_t>
+    static inline void narrow(const array_t& array, const item_t x, size_t& p, size_t& q) {
+        while(q - p > m_cache_num) {
+            bisect<m_le>(array, x, p, q);
+        }
+    }
+};
+
+// interpolation search with a guarded fallback to bisection:
+// whenever an interpolation step fails to halve the interval, a bisection
+// step follows, so that at most twice as many steps as for binary search
+// are needed on skewed inputs
+struct interpolation {
+    template<size_t m_cache_num, bool m_le, typename array_t, typename item_t>
+    static inline void narrow(const array_t& array, const item_t x, size_t& p, size_t& q) {
+        while(q - p > m_cache_num) {
+            const size_t w = q - p;
+            const size_t m = interpolate(array, x, p, q);
+            if(test<m_le>(array[m], x)) p = m; else q = m;
+
+            if(q - p > w / 2 && q - p > m_cache_num) {
+                bisect<m_le>(array, x, p, q);
+            }
+        }
+    }
+};
+
+// interpolation-sequential search: a single interpolation probe is followed
+// by stepping towards x in strides of m_cache_num items
+//
+// this needs very few probes if the interpolation is accurate, e.g., on
+// near-uniform buckets - if it isn't, falls back to bisection after
+// m_max_steps strides
+template<size_t m_max_steps = 4>
+struct interpolation_sequential {
+    template<size_t m_cache_num, bool m_le, typename array_t, typename item_t>
+    static inline void narrow(const array_t& array, const item_t x, size_t& p, size_t& q) {
+        if(q - p <= m_cache_num) return;
+
+        const size_t m = interpolate(array, x, p, q);
+        if(test<m_le>(array[m], x)) {
+            // step to the right
+            p = m;
+            for(size_t i = 0; i < m_max_steps && q - p > m_cache_num; i++) {
+                const size_t s = p + m_cache_num;
+                if(test<m_le>(array[s], x)) {
+                    p = s;
+                } else {
+                    q = s;
+                    break;
+                }
+            }
+        } else {
+            // step to the left
+            q = m;
+            for(size_t i = 0; i < m_max_steps && q - p > m_cache_num; i++) {
+                const size_t s = q - m_cache_num;
+                if(test<m_le>(array[s], x)) {
+                    p = s;
+                    break;
+                } else {
+                    q = s;
+                }
+            }
+        }
+
+        bisection::narrow<m_cache_num, m_le>(array, x, p, q);
+    }
+};
+
+}
+
+}}
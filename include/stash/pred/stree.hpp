@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include <stash/pred/result.hpp>
+#include <stash/pred/util.hpp>
+
+#include <stash/pred/node_search.hpp>
+#include <stash/util/math.hpp>
+
+namespace stash {
+namespace pred {
+
+// static implicit B+-tree (S-tree) on a copy of the input
+// each node holds m_node_num keys and the children of a node are not stored
+// explicitly, but computed from its position like in a binary heap
+//
+// the keys are stored as key_t, which may be a wider native integer type than
+// item_t so that nodes can be searched using SIMD (e.g., uint64_t for uint40_t)
+template<typename array_t, typename item_t, typename key_t = item_t>
+class stree {
+private:
+    // number of keys per node
+    static constexpr size_t m_node_num = 16;
+
+    // number of children per inner node
+    static constexpr size_t m_fanout = m_node_num + 1;
+
+    static constexpr bool m_simd = std::is_unsigned<key_t>::value;
+
+    size_t m_num;
+    item_t m_min;
+    item_t m_max;
+
+    size_t              m_height;    // number of layers, including the leaves
+    std::vector<size_t> m_layer_offs; // node offset of each layer, root layer first
+
+    std::vector<key_t> m_data; // allocated memory
+    key_t*             m_keys; // all nodes, aligned to cache lines
+
+    // counts the keys in the given node that are less than or equal to x
+    static inline size_t node_rank(const key_t* node, const key_t x) {
+        if constexpr(m_simd) {
+            using search_t = node_search<key_t>;
+            if constexpr(search_t::width >= m_node_num) {
+                return search_t::count_le(node, m_node_num, x);
+            } else {
+                // the node spans multiple cache lines
+                size_t c = 0;
+                for(size_t i = 0; i < m_node_num; i += search_t::width) {
+                    c += search_t::count_le(node + i, search_t::width, x);
+                }
+                return c;
+            }
+        } else {
+            // scalar fallback for non-native key types (e.g., uint40_t)
+            size_t c = 0;
+            for(size_t i = 0; i < m_node_num; i++) {
+                c += (node[i] <= x);
+            }
+            return c;
+        }
+    }
+
+    inline const key_t* node(const size_t layer, const size_t k) const {
+        return m_keys + (m_layer_offs[layer] + k) * m_node_num;
+    }
+
+    // computes the number of items that are less than or equal to x
+    // x must be less than m_max
+    inline size_t rank_le(const key_t x) const {
+        size_t k = 0;
+        for(size_t h = 0; h + 1 < m_height; h++) {
+            k = k * m_fanout + node_rank(node(h, k), x);
+        }
+        return k * m_node_num + node_rank(node(m_height - 1, k), x);
+    }
+
+public:
+    inline stree(const array_t& array)
+        : m_num(array.size()),
+          m_min(array[0]),
+          m_max(array[m_num-1]) {
+
+        assert_sorted_ascending(array);
+
+        // compute number of nodes per layer, bottom up
+        std::vector<size_t> layer_nodes;
+        layer_nodes.emplace_back(idiv_ceil(m_num, m_node_num));
+        while(layer_nodes.back() > 1) {
+            layer_nodes.emplace_back(idiv_ceil(layer_nodes.back(), m_fanout));
+        }
+        m_height = layer_nodes.size();
+
+        // compute layer offsets, top down
+        size_t total_nodes = 0;
+        m_layer_offs.reserve(m_height);
+        for(size_t h = 0; h < m_height; h++) {
+            m_layer_offs.emplace_back(total_nodes);
+            total_nodes += layer_nodes[m_height - 1 - h];
+        }
+
+        // allocate so that the root is aligned to a cache line
+        m_data.resize(total_nodes * m_node_num + idiv_ceil(64ULL, sizeof(key_t)));
+        const uintptr_t addr = uintptr_t(m_data.data());
+        m_keys = (key_t*)((addr + 63ULL) & ~uintptr_t(63ULL));
+
+        // keys that don't exist are padded with m_max, which is never counted
+        // because queries for keys greater than or equal to m_max exit early
+        auto get_key = [&](const size_t i){
+            return key_t(uint64_t(i < m_num ? array[i] : m_max));
+        };
+
+        // leaves
+        {
+            key_t* leaves = m_keys + m_layer_offs[m_height - 1] * m_node_num;
+            for(size_t i = 0; i < layer_nodes[0] * m_node_num; i++) {
+                leaves[i] = get_key(i);
+            }
+        }
+
+        // inner nodes - the i-th key of a node is the first item
+        // in the subtree of its (i+1)-th child
+        size_t subtree_items = m_node_num; // number of items below a child
+        for(size_t h = m_height - 1; h > 0; h--) {
+            key_t* nodes = m_keys + m_layer_offs[h - 1] * m_node_num;
+            for(size_t k = 0; k < layer_nodes[m_height - h]; k++) {
+                for(size_t i = 0; i < m_node_num; i++) {
+                    nodes[k * m_node_num + i] = get_key((k * m_fanout + i + 1) * subtree_items);
+                }
+            }
+            subtree_items *= m_fanout;
+        }
+    }
+
+    stree(const stree&) = delete;
+    stree& operator=(const stree&) = delete;
+
+    inline result predecessor(const item_t x) const {
+        if(unlikely(x < m_min))  return result { false, 0 };
+        if(unlikely(x >= m_max)) return result { true, m_num-1 };
+
+        // there is at least one item less than or equal to x
+        return result { true, rank_le(key_t(uint64_t(x))) - 1 };
+    }
+
+    inline result successor(const item_t x) const {
+        if(unlikely(x <= m_min)) return result { true, 0 };
+        if(unlikely(x > m_max))  return result { false, 0 };
+
+        // the successor is preceded by all items less than x
+        return result { true, rank_le(key_t(uint64_t(x) - 1ULL)) };
+    }
+};
+
+}}
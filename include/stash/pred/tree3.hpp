@@ -3,8 +3,8 @@
 #include <stash/pred/result.hpp>
 #include <stash/pred/util.hpp>
 
-#include <stash/vec/int_vector.hpp>
-#include <stash/util/math.hpp>
+#include <stash/pred/binsearch_cache.hpp>
+#include <stash/pred/node_search.hpp>
 
 #include <vector>
 
@@ -17,7 +17,8 @@ template<
     size_t   m_bits1,
     size_t   m_bits2,
     size_t   m_bits3,
-    size_t   m_cache_num = 512ULL / sizeof(item_t)
+    size_t   m_cache_num = 512ULL / sizeof(item_t),
+    typename search_t    = search::bisection
 >
 class tree3 {
 private:
@@ -27,41 +28,38 @@ private:
     static constexpr uint64_t m_mask2 = (1ULL << m_bits2) - 1;
     static constexpr uint64_t m_mask3 = (1ULL << m_bits3) - 1;
 
-    static constexpr uint64_t key1(item_t x) {
+    static constexpr uint64_t key1(uint64_t x) {
         return x >> (m_bits2 + m_bits3);
     }
 
-    static constexpr uint64_t key2(item_t x) {
+    static constexpr uint64_t key2(uint64_t x) {
         return (x >> m_bits3) & m_mask2;
     }
 
-    static constexpr uint64_t key3(item_t x) {
+    static constexpr uint64_t key3(uint64_t x) {
         return x & m_mask3;
     }
 
+    // keys on layers 1 and 2 are stored unpacked so they can be compared using SIMD
+    using key1_t = node_key_t<m_bits1>;
+    using key2_t = node_key_t<m_bits2>;
+
+    using search1_t = node_search<key1_t>;
+    using search2_t = node_search<key2_t>;
+
     const array_t* m_array;
     size_t m_num;
     item_t m_min;
     item_t m_max;
 
-    struct node {
-        size_t     offs;
-        int_vector keys;
-
-        inline node() : offs(0) {
-        }
-
-        inline node(size_t _offs, size_t size, size_t key_bits)
-            : offs(_offs),
-              keys(size, key_bits) {
+    size_t              m_num1;        // number of keys on layer 1
+    std::vector<key1_t> m_layer1;      // one keyset
+    std::vector<size_t> m_layer2_offs; // offsets of the layer 2 nodes in m_layer2
+    std::vector<key2_t> m_layer2;      // keysets of all layer 2 nodes, concatenated
+    std::vector<size_t> m_layer3;      // only offsets (one per layer 2 key)
 
-            assert(size > 0);
-        }
-    };
-
-    node                m_layer1; // one keyset
-    std::vector<node>   m_layer2; // offsets and keysets
-    std::vector<size_t> m_layer3; // only offsets
+    using lo_pred_t = binsearch_cache<array_t, item_t, m_cache_num, search_t>;
+    lo_pred_t m_lo_pred;
 
 public:
     inline tree3(const array_t& array)
@@ -72,19 +70,18 @@ public:
 
         assert_sorted_ascending(array);
 
-        // total numbers of nodes on layers 2 and 3
-        size_t num2 = 1;
-        size_t num3 = 1;
-
-        // counting scan
+        // build layers in a single scan
         {
-            size_t offs2 = 0;
-            size_t offs3 = 0;
-
             uint64_t prev1 = key1(m_min);
             uint64_t prev2 = key2(m_min);
+
+            m_layer1.emplace_back(prev1);
+            m_layer2_offs.emplace_back(0);
+            m_layer2.emplace_back(prev2);
+            m_layer3.emplace_back(0);
+
             for(size_t i = 1; i < m_num; i++) {
-                const item_t x = (*m_array)[i];
+                const uint64_t x = (*m_array)[i];
                 const uint64_t k1 = key1(x);
                 const uint64_t k2 = key2(x);
 
@@ -92,76 +89,111 @@ public:
                 const bool new_l3_node = new_l2_node || (k2 > prev2);
 
                 if(new_l2_node) {
-                    // new node on layer2
-                    ++num2;
-                    m_layer2.emplace_back(offs2, i - offs2, m_bits2);
-                    offs2 = i;
+                    // new node on layer 2
+                    m_layer1.emplace_back(k1);
+                    m_layer2_offs.emplace_back(m_layer2.size());
                     prev1 = k1;
                 }
-                
+
                 if(new_l3_node) {
                     // new node on layer 3
-                    ++num3;
-                    m_layer3.emplace_back(offs3);
-                    offs3 = i;
+                    m_layer2.emplace_back(k2);
+                    m_layer3.emplace_back(i);
                     prev2 = k2;
                 }
             }
 
-            // final nodes on layer 2 and 3
-            m_layer2.emplace_back(offs2, m_num - offs2, m_bits2);
-            m_layer3.emplace_back(offs3);
-
-            // compress
-            m_layer2.shrink_to_fit();
-            m_layer3.shrink_to_fit();
+            // sentinels
+            m_layer2_offs.emplace_back(m_layer2.size());
+            m_layer3.emplace_back(m_num);
         }
 
-        // fill keys on layer 1 and layer 2
-        {
-            uint64_t prev1 = key1(m_min);
-            size_t cur_key1  = 0;
-            size_t cur_node2 = 0;
-            size_t cur_key2  = 0;
-
-            m_layer1 = node(0, num2, m_bits1);
-            m_layer1.keys[cur_key1++] = prev1;
-            m_layer2[cur_node2].keys[cur_key2++] = key2(m_min);
-            
-            for(size_t i = 1; i < m_num; i++) {
-                const item_t x = (*m_array)[i];
-                const uint64_t k1 = key1(x);
-                const uint64_t k2 = key2(x);
-
-                if(k1 > prev1) {
-                    ++cur_node2;
-                    cur_key2 = 0;
-                    m_layer1.keys[cur_key1++] = k1;
-                    prev1 = k1;
-                }
+        // pad keysets so that node searches never read out of bounds
+        m_num1 = m_layer1.size();
+        m_layer1.resize(m_num1 + search1_t::width);
+        m_layer2.resize(m_layer2.size() + search2_t::width);
 
-                m_layer2[cur_node2].keys[cur_key2++] = k2;
-            }
-        }
+        // compress
+        m_layer1.shrink_to_fit();
+        m_layer2_offs.shrink_to_fit();
+        m_layer2.shrink_to_fit();
+        m_layer3.shrink_to_fit();
 
-        //
-        std::cout << "num2=" << num2 << ", num3=" << num3 << std::endl;
+        // build the predecessor data structure for the last layer
+        m_lo_pred = lo_pred_t(array);
     }
 
     inline result predecessor(const item_t x) const {
         if(unlikely(x < m_min))  return result { false, 0 };
         if(unlikely(x >= m_max)) return result { true, m_num-1 };
 
-        // TODO: implement
+        // find predecessor (pred1) of k1 on layer 1 - it exists because x >= m_min
         const uint64_t k1 = key1(x);
-        // TODO: find predecessor (pred1) of k1 in m_layer1.keys
-        // TODO: find predecessor (pred2) of k2 in m_layer2[pred1].keys
-        // -> if it doesn't exist, the result is m_layer2[pred1].offs - 1
-        // TODO: find predecessor of x in interval [m_layer3[pred2].offs, m_layer3[pred2+1].offs]
-        
+        const size_t pred1 = search1_t::rank_le(m_layer1.data(), m_num1, k1) - 1;
+
+        const size_t node_begin = m_layer2_offs[pred1];
+        const size_t node_end = m_layer2_offs[pred1+1];
+        if(m_layer1[pred1] < k1) {
+            // the result is the last item below the next layer 2 node
+            return result { true, m_layer3[node_end] - 1 };
+        }
+
+        // find predecessor (pred2) of k2 in the layer 2 node
         const uint64_t k2 = key2(x);
-        
-        return result { false, 0 };
+        const size_t r2 = search2_t::rank_le(m_layer2.data() + node_begin, node_end - node_begin, k2);
+        if(r2 == 0) {
+            // the result is the last item before the layer 2 node
+            return result { true, m_layer3[node_begin] - 1 };
+        }
+
+        const size_t pred2 = node_begin + r2 - 1;
+        if(m_layer2[pred2] < k2) {
+            // the result is the last item in the layer 3 node
+            return result { true, m_layer3[pred2+1] - 1 };
+        }
+
+        // find predecessor of x in the layer 3 node
+        // the first item of the node may be greater than x, so start from the one before
+        const size_t p = m_layer3[pred2];
+        const size_t q = std::min(m_layer3[pred2+1], m_num - 1);
+        return m_lo_pred.predecessor_seeded(x, p - (p > 0), q);
+    }
+
+    inline result successor(const item_t x) const {
+        if(unlikely(x <= m_min)) return result { true, 0 };
+        if(unlikely(x > m_max))  return result { false, 0 };
+        if(unlikely(x == m_max)) return result { true, m_num-1 };
+
+        // find predecessor (pred1) of k1 on layer 1 - it exists because x > m_min
+        const uint64_t k1 = key1(x);
+        const size_t pred1 = search1_t::rank_le(m_layer1.data(), m_num1, k1) - 1;
+
+        const size_t node_begin = m_layer2_offs[pred1];
+        const size_t node_end = m_layer2_offs[pred1+1];
+        if(m_layer1[pred1] < k1) {
+            // the result is the first item of the next layer 2 node
+            return result { true, m_layer3[node_end] };
+        }
+
+        // find predecessor (pred2) of k2 in the layer 2 node
+        const uint64_t k2 = key2(x);
+        const size_t r2 = search2_t::rank_le(m_layer2.data() + node_begin, node_end - node_begin, k2);
+        if(r2 == 0) {
+            // the result is the first item of the layer 2 node
+            return result { true, m_layer3[node_begin] };
+        }
+
+        const size_t pred2 = node_begin + r2 - 1;
+        if(m_layer2[pred2] < k2) {
+            // the result is the first item of the next layer 3 node
+            return result { true, m_layer3[pred2+1] };
+        }
+
+        // find successor of x in the layer 3 node
+        // the first item of the node may not be less than x, so start from the one before
+        const size_t p = m_layer3[pred2];
+        const size_t q = std::min(m_layer3[pred2+1], m_num - 1);
+        return m_lo_pred.successor_seeded(x, p - (p > 0), q);
     }
 };
 
@@ -1,4 +1,102 @@
 #pragma once
 
+#include <cstdint>
+#include <type_traits>
+
 #include <stash/util/assert.hpp>
 #include <stash/util/likely.hpp>
+#include <stash/util/parallel.hpp>
+#include <stash/vec/int_vector.hpp>
+
+namespace stash {
+namespace pred {
+
+// the number of queries that batched queries process in an interleaved fashion
+constexpr size_t BATCH_SIZE = 16;
+
+// a group of at most BATCH_SIZE queries that are processed together
+template<typename item_t>
+struct query_group {
+    size_t num;
+    item_t x[BATCH_SIZE]; // the queries
+    size_t p[BATCH_SIZE]; // left search interval borders
+    size_t q[BATCH_SIZE]; // right search interval borders
+    size_t j[BATCH_SIZE]; // position of the queries in the batch
+
+    inline query_group() : num(0) {
+    }
+
+    inline void add(const item_t x_, const size_t j_) {
+        x[num] = x_;
+        j[num] = j_;
+        ++num;
+    }
+};
+
+// prefetches the i-th entry of the given array
+// index access on the array must return a reference
+template<typename array_t>
+inline void prefetch(const array_t& array, const size_t i) {
+    __builtin_prefetch(&array[i]);
+}
+
+// prefetches the i-th through j-th entries of the given array
+template<typename array_t>
+inline void prefetch_range(const array_t& array, size_t i, const size_t j) {
+    constexpr size_t step = 64ULL / sizeof(array[0]);
+    for(; i < j; i += step) prefetch(array, i);
+    prefetch(array, j);
+}
+
+// stores the n values in buf into idx, starting at position i
+template<typename idx_t>
+inline void store_range(idx_t& idx, const size_t i, const uint64_t* buf, const size_t n) {
+    if constexpr(std::is_same<idx_t, int_vector>::value) {
+        idx.copy_from(buf, buf + n, i);
+    } else {
+        for(size_t k = 0; k < n; k++) idx[i + k] = buf[k];
+    }
+}
+
+// fills idx[k], for all k in [0, n), with the position of the last item
+// whose high bits (x >> lo_bits) are less than key_min + k, or zero if there
+// is no such item
+//
+// the keys are split into slices that are processed by num_threads threads,
+// and the slice borders are multiples of align
+template<typename array_t, typename idx_t>
+inline void fill_hi_idx(
+    const array_t& array, const size_t lo_bits, const uint64_t key_min,
+    idx_t& idx, const size_t n, const size_t num_threads, const size_t align) {
+
+    const size_t num = array.size();
+    auto key = [&](const size_t i){ return (uint64_t(array[i]) >> lo_bits) - key_min; };
+
+    parallel_for(n, num_threads, [&](const size_t begin, const size_t end){
+        // find the first item with a key of at least begin using binary search
+        size_t i = 0;
+        {
+            size_t q = num;
+            while(i < q) {
+                const size_t m = (i + q) >> 1ULL;
+                if(key(m) < begin) i = m + 1; else q = m;
+            }
+        }
+
+        // scan, storing the entries in blocks
+        uint64_t buf[64];
+        size_t b = 0;
+        for(size_t k = begin; k < end; k++) {
+            while(i < num && key(i) < k) ++i;
+            buf[b++] = i - (i > 0);
+
+            if(b == 64) {
+                store_range(idx, k + 1 - b, buf, b);
+                b = 0;
+            }
+        }
+        store_range(idx, end - b, buf, b);
+    }, align);
+}
+
+}}
@@ -0,0 +1,68 @@
+#pragma once
+
+#if defined(__x86_64__) || defined(__i386__)
+#define STASH_X86
+#include <immintrin.h>
+
+// compiles a function for the given instruction set extensions regardless of
+// the target of the build, so it may only be called if the CPU supports them
+#define STASH_TARGET(isa) __attribute__((target(isa)))
+
+// GCC's AVX-512 intrinsics pass undefined vectors as unused operands, which
+// GCC 12 reports as uninitialized when they are inlined into a STASH_TARGET
+// function in builds that do not target AVX-512 - kernels using them are
+// enclosed in these to keep such builds free of warnings
+#define STASH_SUPPRESS_UNINITIALIZED_BEGIN \
+    _Pragma("GCC diagnostic push") \
+    _Pragma("GCC diagnostic ignored \"-Wuninitialized\"") \
+    _Pragma("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
+#define STASH_SUPPRESS_UNINITIALIZED_END _Pragma("GCC diagnostic pop")
+#endif
+
+namespace stash {
+namespace cpu {
+
+// instruction set extensions supported by the CPU the program runs on
+//
+// SIMD kernels are compiled for several extensions using STASH_TARGET and
+// the best supported one is selected at runtime, so binaries built without
+// -march=native run on any x86-64 CPU - small kernels that are called per
+// query (in-word select, node search) are still inlined if the build targets
+// the extension anyway
+struct features {
+    bool popcnt;
+    bool bmi2;
+    bool avx2;
+    bool avx512f;
+    bool avx512bw;
+    bool avx512vpopcntdq;
+};
+
+inline features detect() {
+    features f = {};
+    #ifdef STASH_X86
+    __builtin_cpu_init();
+    f.popcnt = __builtin_cpu_supports("popcnt");
+    f.bmi2 = __builtin_cpu_supports("bmi2");
+    f.avx2 = __builtin_cpu_supports("avx2");
+    f.avx512f = __builtin_cpu_supports("avx512f");
+    f.avx512bw = f.avx512f && __builtin_cpu_supports("avx512bw");
+    f.avx512vpopcntdq = f.avx512f && __builtin_cpu_supports("avx512vpopcntdq");
+    #endif
+    return f;
+}
+
+// the features of this CPU, detected once
+inline const features& get() {
+    static const features f = detect();
+    return f;
+}
+
+inline bool has_popcnt() { return get().popcnt; }
+inline bool has_bmi2() { return get().bmi2; }
+inline bool has_avx2() { return get().avx2; }
+inline bool has_avx512f() { return get().avx512f; }
+inline bool has_avx512bw() { return get().avx512bw; }
+inline bool has_avx512vpopcntdq() { return get().avx512vpopcntdq; }
+
+}}
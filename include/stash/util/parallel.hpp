@@ -0,0 +1,82 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <stash/util/math.hpp>
+
+namespace stash {
+
+// splits the range [0, n) into at most num_threads consecutive slices and
+// calls f(begin, end) for each of them in a separate thread
+//
+// the slice borders are multiples of align, which can be used to make sure
+// that no two threads write to the same word of a packed vector
+template<typename func_t>
+inline void parallel_for(const size_t n, const size_t num_threads, func_t f, const size_t align = 1) {
+    const size_t slice = idiv_ceil(idiv_ceil(n, std::max(num_threads, size_t(1))), align) * align;
+    if(num_threads <= 1 || slice >= n) {
+        // not worth spawning any threads
+        f(size_t(0), n);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads);
+    for(size_t begin = 0; begin < n; begin += slice) {
+        threads.emplace_back(f, begin, std::min(begin + slice, n));
+    }
+
+    for(auto& t : threads) t.join();
+}
+
+// pins the calling thread to the given core (modulo the number of cores)
+// returns false if that is not supported or fails
+inline bool pin_to_core(const size_t core) {
+    #ifdef __linux__
+    const size_t num_cores = std::max(std::thread::hardware_concurrency(), 1U);
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % num_cores, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    #else
+    return false;
+    #endif
+}
+
+// splits the range [0, n) into num_threads consecutive slices of (almost) equal
+// size and calls f(t, begin, end) for each slice t in a separate thread,
+// which is pinned to core t
+//
+// the threads wait for each other before calling f, so that they start at
+// the same time and compete for memory bandwidth and caches throughout
+template<typename func_t>
+inline void parallel_for_pinned(const size_t n, const size_t num_threads, func_t f) {
+    std::atomic<size_t> ready(0);
+    auto run = [&](const size_t t){
+        pin_to_core(t);
+
+        ++ready;
+        while(ready.load() < num_threads) std::this_thread::yield();
+
+        f(t, n * t / num_threads, n * (t + 1) / num_threads);
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads);
+    for(size_t t = 0; t < num_threads; t++) {
+        threads.emplace_back(run, t);
+    }
+
+    for(auto& t : threads) t.join();
+}
+
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
 #include <random>
 #include <vector>
 
@@ -65,6 +67,32 @@ namespace stash {
                 return vec;
             }
         };
+
+        // draws ranks in [0, n) following Zipf's law with exponent s, i.e.,
+        // rank r is drawn with probability proportional to 1 / (r+1)^s
+        //
+        // uses the inverse of the continuous approximation of the distribution
+        // function, which is accurate enough for generating workloads
+        class zipf {
+        private:
+            uint64_t m_num;
+            double m_exp;  // 1 - s
+            double m_span; // n^(1-s) - 1, or ln(n) for s = 1
+
+        public:
+            zipf(uint64_t n, double s) : m_num(n), m_exp(1.0 - s) {
+                m_span = (std::abs(m_exp) < 1e-9) ? std::log(double(n)) : std::pow(double(n), m_exp) - 1.0;
+            }
+
+            template<typename gen_t>
+            inline uint64_t operator()(gen_t& gen) const {
+                const double u = std::uniform_real_distribution<double>(0.0, 1.0)(gen);
+                const double r = (std::abs(m_exp) < 1e-9)
+                    ? std::exp(u * m_span)
+                    : std::pow(u * m_span + 1.0, 1.0 / m_exp);
+                return std::min(uint64_t(std::max(r, 1.0)) - 1, m_num - 1);
+            }
+        };
     };
     
     // generate a random vector from 0 to universe (inclusive)
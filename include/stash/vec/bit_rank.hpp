@@ -4,6 +4,7 @@
 #include <utility>
 
 #include <stash/vec/bit_vector.hpp>
+#include <stash/vec/fixed_int_vector.hpp>
 #include <stash/vec/int_vector.hpp>
 #include <stash/util/math.hpp>
 
@@ -20,10 +21,13 @@ private:
         
     std::shared_ptr<const bit_vector> m_bv;
 
-    int_vector m_blocks;    // size 64 each
-    int_vector m_supblocks; // size SUP_SZ each
+    fixed_int_vector<SUP_W> m_blocks; // size 64 each
+    int_vector m_supblocks;           // size SUP_SZ each
 
 public:
+    // the bit vector is needed for queries (see bit_rank_interleaved)
+    static constexpr bool stores_bits = false;
+
     inline bit_rank(std::shared_ptr<const bit_vector> bv) : m_bv(bv) {
         const size_t n = m_bv->size();
 
@@ -36,7 +40,7 @@ public:
         // determine number of blocks and block width
         const size_t bq = n >> 6ULL; // div 64
         const size_t bm = n & 63ULL; // mod 64
-        m_blocks.resize(bm ? bq + 1 : bq, SUP_W);
+        m_blocks.resize(bm ? bq + 1 : bq);
 
         // construct
         {
@@ -44,7 +48,12 @@ public:
             size_t rank_sb = 0; // 1-bits in current superblock
             size_t cur_sb = 0;  // current superblock
 
-            for(size_t j = 0; j < m_blocks.size(); j++) {
+            // block entries are collected and stored in bulk
+            uint64_t buf[BLOCKS_PER_SB];
+            size_t b = 0;
+
+            // the words are popcounted in bulk
+            m_bv->popcount_blocks(1, [&](const size_t j, const size_t rank_b){
                 size_t i = j >> SB_INNER_RS;
                 if(i > cur_sb) {
                     // we reached a new superblock
@@ -53,15 +62,26 @@ public:
                     cur_sb = i;
                 }
 
-                auto rank_b = rank1_u64(m_bv->block64(j));
                 rank_sb += rank_b;
                 rank_bv += rank_b;
 
-                m_blocks[j] = rank_sb;
-            }
+                buf[b++] = rank_sb;
+                if(b == BLOCKS_PER_SB) {
+                    m_blocks.copy_from(buf, buf + b, j + 1 - b);
+                    b = 0;
+                }
+            });
+            m_blocks.copy_from(buf, buf + b, m_blocks.size() - b);
         }
     }
 
+    // maps rank support written using write for the given bit vector
+    inline bit_rank(std::shared_ptr<const bit_vector> bv, io::mapped_reader& in)
+        : m_bv(bv),
+          m_blocks(in),
+          m_supblocks(in) {
+    }
+
     inline bit_rank() : m_bv(nullptr) {
     }
 
@@ -104,9 +124,25 @@ public:
         return rank1(i);
     }
 
+    // prefetches the memory accessed by rank queries for x
+    inline void prefetch(const size_t x) const {
+        const size_t i = x >> SUP_W;
+        const size_t j = x >> 6ULL;
+        m_supblocks.prefetch(i - (i > 0));
+        m_blocks.prefetch(j - (j > 0));
+        m_bv->prefetch(x);
+    }
+
     inline size_t rank0(size_t x) const {
         return x + 1 - rank1(x);
     }
+
+    // writes the rank support (not the bit vector) so that it can be mapped
+    // into memory later
+    inline void write(io::serializer& out) const {
+        m_blocks.write(out);
+        m_supblocks.write(out);
+    }
 };
 
 }
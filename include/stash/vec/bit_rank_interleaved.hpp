@@ -0,0 +1,147 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <stash/io/serialize.hpp>
+#include <stash/vec/bit_vector.hpp>
+#include <stash/vec/util.hpp>
+#include <stash/util/math.hpp>
+
+namespace stash {
+
+// rank support that interleaves the counters with a copy of the bits,
+// so that a query touches a single cache line
+//
+// every line of 8 words consists of the number of 1-bits before the line,
+// followed by 7 words (448 bits) of the bit vector - a query reads the counter
+// and popcounts the words of its line up to the queried bit
+//
+// the bit vector is not needed after construction (stores_bits), so the
+// owner may discard it to avoid keeping the bits twice
+class bit_rank_interleaved {
+private:
+    static constexpr size_t LINE_WORDS = 8;
+    static constexpr size_t DATA_WORDS = LINE_WORDS - 1;
+    static constexpr size_t LINE_BITS = DATA_WORDS * 64ULL;
+
+    size_t m_size;
+    size_t m_num_lines;
+
+    // the lines - either in m_data, aligned to a cache line,
+    // or in a mapped file, in which case m_mapping keeps the file alive
+    std::vector<uint64_t>       m_data;
+    const uint64_t*             m_lines;
+    std::shared_ptr<const void> m_mapping;
+
+    // allocates the lines so that they are aligned to cache lines
+    inline uint64_t* allocate(const size_t num_lines) {
+        m_num_lines = num_lines;
+        m_data.resize(num_lines * LINE_WORDS + LINE_WORDS - 1);
+        const uintptr_t addr = uintptr_t(m_data.data());
+        uint64_t* lines = (uint64_t*)((addr + 63ULL) & ~uintptr_t(63ULL));
+        m_lines = lines;
+        return lines;
+    }
+
+public:
+    static constexpr bool stores_bits = true;
+
+    inline bit_rank_interleaved(std::shared_ptr<const bit_vector> bv) : m_size(bv->size()) {
+        const size_t num_blocks = bv->num_blocks();
+        uint64_t* lines = allocate(idiv_ceil(num_blocks, DATA_WORDS));
+
+        // popcount the lines in bulk and copy the bits along the way
+        size_t rank = 0;
+        bv->popcount_blocks(DATA_WORDS, [&](const size_t l, const size_t r){
+            uint64_t* line = lines + l * LINE_WORDS;
+            line[0] = rank;
+            rank += r;
+
+            for(size_t k = 0; k < DATA_WORDS; k++) {
+                const size_t j = l * DATA_WORDS + k;
+                line[1 + k] = (j < num_blocks) ? bv->block64(j) : 0;
+            }
+        });
+    }
+
+    // maps rank support written using write - the bit vector is not needed
+    inline bit_rank_interleaved(std::shared_ptr<const bit_vector>, io::mapped_reader& in) {
+        m_size = in.read();
+        m_num_lines = in.read();
+        m_lines = in.read(m_num_lines * LINE_WORDS);
+        m_mapping = in.mapping();
+    }
+
+    inline bit_rank_interleaved() : m_size(0), m_num_lines(0), m_lines(nullptr) {
+    }
+
+    inline bit_rank_interleaved(const bit_rank_interleaved& other) {
+        *this = other;
+    }
+
+    inline bit_rank_interleaved(bit_rank_interleaved&& other) {
+        *this = std::move(other);
+    }
+
+    inline bit_rank_interleaved& operator=(const bit_rank_interleaved& other) {
+        m_size = other.m_size;
+        m_mapping = other.m_mapping;
+        if(m_mapping) {
+            m_num_lines = other.m_num_lines;
+            m_lines = other.m_lines;
+        } else {
+            // the copy may be aligned differently
+            uint64_t* lines = allocate(other.m_num_lines);
+            std::copy(other.m_lines, other.m_lines + m_num_lines * LINE_WORDS, lines);
+        }
+        return *this;
+    }
+
+    inline bit_rank_interleaved& operator=(bit_rank_interleaved&& other) {
+        m_size = other.m_size;
+        m_num_lines = other.m_num_lines;
+        m_data = std::move(other.m_data);
+        m_lines = other.m_lines; // moving the vector keeps the buffer
+        m_mapping = std::move(other.m_mapping);
+        return *this;
+    }
+
+    inline size_t rank1(const size_t x) const {
+        const uint64_t* line = m_lines + (x / LINE_BITS) * LINE_WORDS;
+        const size_t o = x % LINE_BITS;
+        const size_t w = o >> 6ULL;
+
+        size_t r = line[0];
+        for(size_t k = 0; k < w; k++) {
+            r += rank1_u64(line[1 + k]);
+        }
+        r += rank1_u64(line[1 + w], o & 63ULL);
+        return r;
+    }
+
+    inline size_t operator()(size_t i) const {
+        return rank1(i);
+    }
+
+    // prefetches the memory accessed by rank queries for x
+    inline void prefetch(const size_t x) const {
+        __builtin_prefetch(m_lines + (x / LINE_BITS) * LINE_WORDS);
+    }
+
+    inline size_t rank0(size_t x) const {
+        return x + 1 - rank1(x);
+    }
+
+    // writes the rank support, including the bits, so that it can be mapped
+    // into memory later - note that mapped lines are only aligned to words
+    inline void write(io::serializer& out) const {
+        out.write(m_size);
+        out.write(m_num_lines);
+        out.write(m_lines, m_num_lines * LINE_WORDS);
+    }
+};
+
+}
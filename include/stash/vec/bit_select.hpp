@@ -1,136 +1,140 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include <stash/util/math.hpp>
 #include <stash/vec/bit_vector.hpp>
-#include <stash/vec/int_vector.hpp>
+#include <stash/vec/util.hpp>
 
 namespace stash {
 
+// select support in the style of cs-poppy
+//
+// every m_sample-th matching bit, the 512-bit block containing it is sampled,
+// and for every block, the number of matching bits before it is stored
+// (relative to superblocks of 2^32 bits) - a query looks up the samples
+// before and after the searched bit, searches the block counts between them and
+// finishes with popcounts and an in-word select (select1_u64) in the block
 template<bool m_bit>
 class bit_select {
 private:
-    static constexpr uint8_t basic_rank(uint64_t v);
-    static constexpr uint8_t basic_rank(uint64_t v, uint8_t x);
-    static constexpr uint8_t basic_rank(uint64_t v, uint8_t a, uint8_t b);
-    static constexpr uint8_t basic_select(uint64_t v, uint8_t k);
-    static constexpr uint8_t basic_select(uint64_t v, uint8_t l, uint8_t k);
+    static constexpr size_t BLOCK_WORDS = 8;
+    static constexpr size_t BLOCK_W = 9;  // log2 of the block size in bits
+    static constexpr size_t SUP_W = 23;   // log2 of the blocks per superblock
+    static constexpr size_t SAMPLE = 4096;
+
+    // the number of blocks between two samples up to which they are scanned
+    // linearly rather than using binary search
+    static constexpr size_t LINEAR_BLOCKS = 16;
 
     std::shared_ptr<const bit_vector> m_bv;
 
-    size_t m_max;
-    size_t m_block_size;
-    size_t m_supblock_size;
-    size_t m_blocks_per_supblock;
+    size_t m_max;        // the number of matching bits
+    size_t m_num_blocks;
+    size_t m_num_samples;
+
+    // the directory - either in m_data or in a mapped file, in which case
+    // m_mapping keeps the file alive
+    std::vector<uint64_t>       m_data;
+    std::shared_ptr<const void> m_mapping;
+    const uint64_t* m_samples; // block containing each sampled bit
+    const uint64_t* m_sup;     // matching bits before each superblock
+    const uint64_t* m_blocks;  // matching bits before each block within its superblock,
+                               // packed as 32-bit values into words
+
+    static constexpr size_t num_sup(const size_t num_blocks) {
+        return (num_blocks >> SUP_W) + 1;
+    }
+
+    inline size_t num_words() const {
+        return m_num_samples + num_sup(m_num_blocks) + idiv_ceil(m_num_blocks, 2ULL);
+    }
+
+    // points the directory into the given words
+    inline void attach(const uint64_t* words) {
+        m_samples = words;
+        m_sup = m_samples + m_num_samples;
+        m_blocks = m_sup + num_sup(m_num_blocks);
+    }
+
+    // the i-th word of the bit vector, in which matching bits are set
+    inline uint64_t word(const size_t i) const {
+        const uint64_t v = m_bv->block64(i);
+        return m_bit ? v : ~v;
+    }
 
-    int_vector m_blocks;
-    int_vector m_supblocks;
+    // the number of matching bits before block b
+    inline size_t count(const size_t b) const {
+        // copy the 32-bit value rather than reading through a uint32_t pointer
+        // into the words, which compiles to the same load
+        uint32_t c;
+        __builtin_memcpy(&c, (const char*)m_blocks + b * sizeof(uint32_t), sizeof(uint32_t));
+        return m_sup[b >> SUP_W] + c;
+    }
 
 public:
     inline bit_select(std::shared_ptr<const bit_vector> bv) : m_bv(bv) {
         const size_t n = m_bv->size();
-        const size_t log_n = log2_ceil(n - 1);
+        const size_t num_words64 = m_bv->num_blocks();
+        m_num_blocks = idiv_ceil(num_words64, BLOCK_WORDS);
 
-        // construct
-        m_block_size    = log_n;
-        m_supblock_size = log_n * log_n;
-        m_blocks_per_supblock = log_n;
-
-        m_supblocks = int_vector(idiv_ceil(n, m_supblock_size), log_n);
-        m_blocks = int_vector(idiv_ceil(n, m_block_size), log_n);
+        // count matching bits per block, popcounting the words in bulk
+        std::vector<uint64_t> samples;
+        std::vector<uint64_t> counts(m_num_blocks);
 
         m_max = 0;
-        size_t r_sb = 0; // current bit count in superblock
-        size_t r_b = 0;  // current bit count in block
-
-        size_t cur_sb = 0;        // current superblock
-        size_t cur_sb_offset = 0; // starting position of current superblock
-        size_t longest_sb = 0;    // length of longest superblock
-
-        size_t cur_b = 0; // current block
-
-        const size_t num_blocks = m_bv->num_blocks();
-        
-        for(size_t i = 0; i < num_blocks; i++) {
-            const auto v = m_bv->block64(i);
-            
-            uint8_t r;
-            if(i + 1 < num_blocks) {
-                // get amount flag bits in whole data element
-                r = basic_rank(v);
-            } else {
-                // only get amount of flag bits up to end of bit vector
-                const size_t m = n & 63ULL; // mod 64
-                if(m > 0) {
-                    r = basic_rank(v, m-1);
-                } else {
-                    r = basic_rank(v); // full element, but last one
-                }
+        m_bv->popcount_blocks(BLOCK_WORDS, [&](const size_t b, const size_t ones){
+            // for 0-bits, only count up to the end of the bit vector
+            const size_t r = m_bit ? ones : std::min(n - (b << BLOCK_W), size_t(1) << BLOCK_W) - ones;
+
+            // sample the block if it contains the next sampled bit
+            counts[b] = m_max;
+            if(r > 0 && (m_max + r - 1) / SAMPLE >= samples.size()) {
+                samples.push_back(b);
             }
-
             m_max += r;
-
-            if(r_b + r >= m_block_size) {
-                // entered new block
-
-                // amount of bits needed to fill current block
-                size_t distance_b = m_block_size - r_b;
-
-                // stores the offset of the last bit in the current block
-                uint8_t offs = 0;
-
-                r_b += r;
-
-                size_t distance_sum = 0;
-                while(r_b >= m_block_size) {
-                    // find exact position of the bit in question
-                    offs = basic_select(v, offs, distance_b);
-                    assert(SELECT_FAIL != offs);
-
-                    const size_t pos = (i << 6ULL) + offs; // mul 64
-
-                    distance_sum += distance_b;
-                    r_sb += distance_b;
-                    if(r_sb >= m_supblock_size) {
-                        // entered new superblock
-                        longest_sb = std::max(longest_sb, pos - cur_sb_offset);
-                        cur_sb_offset = pos;
-
-                        m_supblocks[cur_sb++] = pos;
-
-                        r_sb -= m_supblock_size;
-                    }
-
-                    m_blocks[cur_b++] = pos - cur_sb_offset;
-                    r_b -= m_block_size;
-                    distance_b = m_block_size;
-
-                    ++offs;
-                }
-
-                assert(size_t(r) >= distance_sum);
-                r_sb += r - distance_sum;
-            } else {
-                r_b  += r;
-                r_sb += r;
-            }
+        });
+        m_num_samples = samples.size();
+
+        // store
+        m_data.resize(num_words());
+        uint64_t* words = m_data.data();
+        std::copy(samples.begin(), samples.end(), words);
+
+        uint64_t* sup = words + m_num_samples;
+        char* blocks = (char*)(sup + num_sup(m_num_blocks));
+        for(size_t b = 0; b < m_num_blocks; b++) {
+            if((b & bit_mask(SUP_W)) == 0) sup[b >> SUP_W] = counts[b];
+            const uint32_t c = uint32_t(counts[b] - sup[b >> SUP_W]);
+            __builtin_memcpy(blocks + b * sizeof(uint32_t), &c, sizeof(uint32_t));
         }
 
-        longest_sb = std::max(longest_sb, n - cur_sb_offset);
-        const size_t w_block = log2_ceil(longest_sb);
+        attach(words);
+    }
+
+    // maps select support written using write for the given bit vector
+    inline bit_select(std::shared_ptr<const bit_vector> bv, io::mapped_reader& in)
+        : m_bv(bv),
+          m_max(in.read()),
+          m_num_blocks(in.read()),
+          m_num_samples(in.read()),
+          m_mapping(in.mapping()) {
 
-        m_supblocks.rebuild(cur_sb, log_n);
-        m_blocks.rebuild(cur_b, w_block);
+        attach(in.read(num_words()));
     }
 
     inline bit_select()
         : m_bv(nullptr),
           m_max(0),
-          m_block_size(0),
-          m_supblock_size(0),
-          m_blocks_per_supblock(0) {
+          m_num_blocks(0),
+          m_num_samples(0),
+          m_samples(nullptr),
+          m_sup(nullptr),
+          m_blocks(nullptr) {
     }
 
     inline bit_select(const bit_select& other) {
@@ -144,22 +148,22 @@ public:
     inline bit_select& operator=(const bit_select& other) {
         m_bv = other.m_bv;
         m_max = other.m_max;
-        m_block_size = other.m_block_size;
-        m_supblock_size = other.m_supblock_size;
-        m_blocks_per_supblock = other.m_blocks_per_supblock;
-        m_blocks = other.m_blocks;
-        m_supblocks = other.m_supblocks;
+        m_num_blocks = other.m_num_blocks;
+        m_num_samples = other.m_num_samples;
+        m_data = other.m_data;
+        m_mapping = other.m_mapping;
+        attach(m_mapping ? other.m_samples : m_data.data());
         return *this;
     }
 
     inline bit_select& operator=(bit_select&& other) {
         m_bv = std::move(other.m_bv);
         m_max = other.m_max;
-        m_block_size = other.m_block_size;
-        m_supblock_size = other.m_supblock_size;
-        m_blocks_per_supblock = other.m_blocks_per_supblock;
-        m_blocks = std::move(other.m_blocks);
-        m_supblocks = std::move(other.m_supblocks);
+        m_num_blocks = other.m_num_blocks;
+        m_num_samples = other.m_num_samples;
+        m_data = std::move(other.m_data);
+        m_mapping = std::move(other.m_mapping);
+        attach(m_mapping ? other.m_samples : m_data.data());
         return *this;
     }
 
@@ -167,108 +171,47 @@ public:
         assert(x > 0);
         if(x > m_max) return m_bv->size();
 
-        size_t pos = 0;
-
-        //narrow down to block
-        {
-            const size_t i = x / m_supblock_size;
-            const size_t j = x / m_block_size;
+        // the searched bit is in a block between the surrounding samples
+        const size_t j = (x - 1) / SAMPLE;
+        size_t p = m_samples[j];
+        size_t q = (j + 1 < m_num_samples) ? size_t(m_samples[j + 1]) : m_num_blocks - 1;
 
-            if(i > 0) {
-                pos += m_supblocks[i-1];
-                x -= i * m_supblock_size;
-            }
-            if(x == 0) return pos;
-
-            // block j is the k-th block within the i-th superblock
-            size_t k = j - i * m_blocks_per_supblock;
-            if(k > 0) {
-                pos += m_blocks[j-1];
-                x   -= k * m_block_size;
-            }
-            if(x == 0) return pos;
-
-            if(i > 0 || k > 0) ++pos; // offset from block boundary
+        // find the last block before which there are less than x matching bits
+        while(q - p > LINEAR_BLOCKS) {
+            const size_t m = (p + q + 1) >> 1ULL;
+            if(count(m) < x) p = m; else q = m - 1;
         }
-
-        // from this point forward, search directly in the bit vector
-        size_t i = pos >> 6ULL; // div 64
-        size_t offs  = pos & 63ULL; // mod 64
-
-        uint64_t block = m_bv->block64(i);
-        uint8_t s = basic_select(block, offs, x);
-        if(s != SELECT_FAIL) {
-            // found in first data segment
-            return pos + s - offs;
-        } else {
-            // linearly search in the next segments
-            x -= basic_rank(block, offs, 63ULL);
-            while(s == SELECT_FAIL) {
-                ++i;
-                pos = i << 6ULL; // mul 64
-                block = m_bv->block64(i);
-                s = basic_select(block, x);
-                if(s == SELECT_FAIL) x -= basic_rank(block);
-            };
-
-            return pos + s;
+        while(p < q && count(p + 1) < x) ++p;
+
+        // search the words of the block
+        x -= count(p);
+        size_t i = p * BLOCK_WORDS;
+        uint64_t v = word(i);
+        for(uint8_t r = rank1_u64(v); r < x; r = rank1_u64(v)) {
+            x -= r;
+            v = word(++i);
         }
+        return (i << 6ULL) + select1_u64(v, x);
     }
 
     inline size_t operator()(size_t x) const {
         return select(x);
     }
-};
-
-template<>
-inline constexpr uint8_t bit_select<0>::basic_rank(uint64_t v) {
-    return 64ULL - rank1_u64(v);
-}
-
-template<>
-inline constexpr uint8_t bit_select<0>::basic_rank(uint64_t v, uint8_t x) {
-    return x + 1 - rank1_u64(v, x);
-}
-
-template<>
-inline constexpr uint8_t bit_select<0>::basic_rank(uint64_t v, uint8_t a, uint8_t b) {
-    return (b-a+1) - rank1_u64(v, a, b);
-}
-
-template<>
-inline constexpr uint8_t bit_select<0>::basic_select(uint64_t v, uint8_t k) {
-    return select0_u64(v, k);
-}
 
-template<>
-inline constexpr uint8_t bit_select<0>::basic_select(uint64_t v, uint8_t l, uint8_t k) {
-    return select0_u64(v, l, k);
-}
-
-template<>
-inline constexpr uint8_t bit_select<1>::basic_rank(uint64_t v) {
-    return rank1_u64(v);
-}
-
-template<>
-inline constexpr uint8_t bit_select<1>::basic_rank(uint64_t v, uint8_t x) {
-    return rank1_u64(v, x);
-}
-
-template<>
-inline constexpr uint8_t bit_select<1>::basic_rank(uint64_t v, uint8_t a, uint8_t b) {
-    return rank1_u64(v, a, b);
-}
-
-template<>
-inline constexpr uint8_t bit_select<1>::basic_select(uint64_t v, uint8_t k) {
-    return select1_u64(v, k);
-}
+    // prefetches the directory entries accessed by select queries for x
+    inline void prefetch(const size_t x) const {
+        __builtin_prefetch(m_samples + (x - (x > 0)) / SAMPLE);
+    }
 
-template<>
-inline constexpr uint8_t bit_select<1>::basic_select(uint64_t v, uint8_t l, uint8_t k) {
-    return select1_u64(v, l, k);
-}
+    // writes the select support (not the bit vector) so that it can be mapped
+    // into memory later
+    inline void write(io::serializer& out) const {
+        out.write(m_max);
+        out.write(m_num_blocks);
+        out.write(m_num_samples);
+        out.write(m_samples, num_words());
+    }
+};
 
 using bit_select0 = bit_select<0>;
 using bit_select1 = bit_select<1>;
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <stash/util/cpu.hpp>
+#include <stash/vec/util.hpp>
+
+namespace stash {
+
+// kernels that unpack consecutive integers of w bits (1 to 64) from a packed
+// array of words, as stored by int_vector
+//
+// in the style of FastPFor, every SIMD lane extracts one integer: the two
+// words it spans are moved into the lane using a permutation of unaligned
+// loads, and then shifted and masked - no gathers are needed, because the
+// words of 8 (AVX-512) or 4 (AVX2) consecutive integers of w <= 64 bits are
+// always found within 9 (5) consecutive words
+//
+// the kernel is selected at runtime (see cpu.hpp)
+namespace bit_unpack {
+
+// extracts the integer of w bits (with mask) starting at bit pos
+inline uint64_t get(const uint64_t* words, const size_t pos, const size_t w, const uint64_t mask) {
+    const size_t a = pos >> 6ULL;
+    const size_t d = pos & 63ULL;
+    const size_t b = (pos + w - 1ULL) >> 6ULL;
+    return ((words[a] >> d) | ((words[b] << 1ULL) << (63ULL - d))) & mask;
+}
+
+// scalar kernel, which unpacks n integers of w bits starting at bit pos
+inline void unpack_scalar(const uint64_t* words, const size_t, size_t pos, const size_t w, const size_t n, uint64_t* out) {
+    const uint64_t mask = bit_mask(w);
+    for(size_t k = 0; k < n; k++) {
+        out[k] = get(words, pos, w, mask);
+        pos += w;
+    }
+}
+
+#ifdef STASH_X86
+// AVX-512 kernel, 8 integers per step
+STASH_SUPPRESS_UNINITIALIZED_BEGIN
+STASH_TARGET("avx512f")
+inline void unpack_avx512(const uint64_t* words, const size_t num_words, size_t pos, const size_t w, const size_t n, uint64_t* out) {
+    const __m512i mask = _mm512_set1_epi64(bit_mask(w));
+    const __m512i lanes = _mm512_set_epi64(7 * w, 6 * w, 5 * w, 4 * w, 3 * w, 2 * w, w, 0);
+    const __m512i c63 = _mm512_set1_epi64(63);
+    const __m512i c64 = _mm512_set1_epi64(64);
+
+    size_t k = 0;
+    for(; k + 8 <= n; k += 8) {
+        const size_t a = pos >> 6ULL;
+        if(a + 9 > num_words) break; // the loads would exceed the array
+
+        // bit offsets of the lanes relative to word a
+        const __m512i rel = _mm512_add_epi64(_mm512_set1_epi64(pos & 63ULL), lanes);
+        const __m512i idx = _mm512_srli_epi64(rel, 6);
+        const __m512i d = _mm512_and_si512(rel, c63);
+
+        const __m512i lo = _mm512_permutexvar_epi64(idx, _mm512_loadu_si512(words + a));
+        const __m512i hi = _mm512_permutexvar_epi64(idx, _mm512_loadu_si512(words + a + 1));
+
+        // shifts by 64 or more yield zero
+        const __m512i v = _mm512_or_si512(
+            _mm512_srlv_epi64(lo, d),
+            _mm512_sllv_epi64(hi, _mm512_sub_epi64(c64, d)));
+
+        _mm512_storeu_si512(out + k, _mm512_and_si512(v, mask));
+        pos += 8 * w;
+    }
+
+    unpack_scalar(words, num_words, pos, w, n - k, out + k);
+}
+STASH_SUPPRESS_UNINITIALIZED_END
+
+// AVX2 kernel, 4 integers per step
+STASH_TARGET("avx2")
+inline void unpack_avx2(const uint64_t* words, const size_t num_words, size_t pos, const size_t w, const size_t n, uint64_t* out) {
+    const __m256i mask = _mm256_set1_epi64x(bit_mask(w));
+    const __m256i lanes = _mm256_set_epi64x(3 * w, 2 * w, w, 0);
+    const __m256i c63 = _mm256_set1_epi64x(63);
+    const __m256i c64 = _mm256_set1_epi64x(64);
+
+    // turns word indices into pairs of 32-bit indices for the permutation
+    const __m256i c_dup = _mm256_set_epi32(1, 0, 1, 0, 1, 0, 1, 0);
+
+    size_t k = 0;
+    for(; k + 4 <= n; k += 4) {
+        const size_t a = pos >> 6ULL;
+        if(a + 5 > num_words) break; // the loads would exceed the array
+
+        // bit offsets of the lanes relative to word a
+        const __m256i rel = _mm256_add_epi64(_mm256_set1_epi64x(pos & 63ULL), lanes);
+        const __m256i idx = _mm256_srli_epi64(rel, 6);
+        const __m256i d = _mm256_and_si256(rel, c63);
+
+        const __m256i idx32 = _mm256_or_si256(_mm256_add_epi32(_mm256_slli_epi64(idx, 33), _mm256_slli_epi64(idx, 1)), c_dup);
+        const __m256i lo = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i*)(words + a)), idx32);
+        const __m256i hi = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i*)(words + a + 1)), idx32);
+
+        // shifts by 64 or more yield zero
+        const __m256i v = _mm256_or_si256(
+            _mm256_srlv_epi64(lo, d),
+            _mm256_sllv_epi64(hi, _mm256_sub_epi64(c64, d)));
+
+        _mm256_storeu_si256((__m256i*)(out + k), _mm256_and_si256(v, mask));
+        pos += 4 * w;
+    }
+
+    unpack_scalar(words, num_words, pos, w, n - k, out + k);
+}
+#endif
+
+// the name of the kernel used by unpack
+inline const char* kernel() {
+    #ifdef STASH_X86
+    if(cpu::has_avx512f()) return "avx512";
+    if(cpu::has_avx2()) return "avx2";
+    #endif
+    return "scalar";
+}
+
+// the largest value returned by block_size
+constexpr size_t MAX_BLOCK = 128;
+
+// the number of integers worth unpacking at once by the kernel used by
+// unpack, i.e., enough for its main loop to amortize the scalar tail
+inline size_t block_size() {
+    #ifdef STASH_X86
+    if(cpu::has_avx512f()) return 128;
+    #endif
+    return 64;
+}
+
+// unpacks n integers of w bits starting at bit pos from the num_words
+// given words into out, using the widest kernel supported by the CPU
+inline void unpack(const uint64_t* words, const size_t num_words, const size_t pos, const size_t w, const size_t n, uint64_t* out) {
+    #ifdef STASH_X86
+    if(cpu::has_avx512f()) {
+        unpack_avx512(words, num_words, pos, w, n, out);
+        return;
+    }
+    if(cpu::has_avx2()) {
+        unpack_avx2(words, num_words, pos, w, n, out);
+        return;
+    }
+    #endif
+    unpack_scalar(words, num_words, pos, w, n, out);
+}
+
+}
+
+}
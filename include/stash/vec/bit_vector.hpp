@@ -1,10 +1,15 @@
 #pragma once
 
+#include <cassert>
 #include <cstdint>
+#include <memory>
 #include <vector>
 #include <utility>
 
+#include <stash/io/serialize.hpp>
+#include <stash/util/likely.hpp>
 #include <stash/util/math.hpp>
+#include <stash/vec/popcount.hpp>
 
 namespace stash {
 
@@ -12,6 +17,11 @@ class bit_vector {
 private:
     size_t m_size;
     std::vector<uint64_t> m_bits;
+
+    // the words that are read - either m_bits or memory in a mapped file,
+    // in which case the vector is read-only and m_mapping keeps the file alive
+    const uint64_t*             m_words;
+    std::shared_ptr<const void> m_mapping;
     
     inline static constexpr size_t block(size_t i) {
         return i >> 6ULL; // divide by 64
@@ -28,10 +38,12 @@ private:
         //~ return bool(m_bits[q] & mask);
         
         // more optimization-friendly:
-        return bool(m_bits[i >> 6ULL] & (1ULL << (i & 63ULL)));
+        return bool(m_words[i >> 6ULL] & (1ULL << (i & 63ULL)));
     }
 
     inline void bitset(size_t i, bool b) {
+        assert(!m_mapping);
+        assert(i < m_size);
         const size_t q = block(i);
         const size_t mask = (1ULL << offset(i));
         m_bits[q] = (m_bits[q] & ~mask) | (-b & mask);
@@ -51,7 +63,7 @@ public:
         }
     };
 
-    inline bit_vector() : m_size(0) {
+    inline bit_vector() : m_size(0), m_words(nullptr) {
     }
 
     inline bit_vector(const bit_vector& other) {
@@ -64,6 +76,14 @@ public:
 
     inline bit_vector(size_t size) : m_size(size) {
         m_bits.resize(idiv_ceil(size, 64ULL));
+        m_words = m_bits.data();
+    }
+
+    // maps a bit vector written using write
+    inline bit_vector(io::mapped_reader& in) {
+        m_size = in.read();
+        m_words = in.read(idiv_ceil(m_size, 64ULL));
+        m_mapping = in.mapping();
     }
 
     inline bit_vector(const std::vector<bool>& bv) : bit_vector(bv.size()) {
@@ -76,21 +96,25 @@ public:
     inline bit_vector& operator=(const bit_vector& other) {
         m_size = other.m_size;
         m_bits = other.m_bits;
+        m_mapping = other.m_mapping;
+        m_words = m_mapping ? other.m_words : m_bits.data();
         return *this;
     }
 
     inline bit_vector& operator=(bit_vector&& other) {
         m_size = std::move(other.m_size);
         m_bits = std::move(other.m_bits);
+        m_mapping = std::move(other.m_mapping);
+        m_words = m_mapping ? other.m_words : m_bits.data();
         return *this;
     }
 
     inline uint64_t block64(size_t i) const {
-        return m_bits[i];
+        return m_words[i];
     }
 
     inline size_t num_blocks() const {
-        return m_bits.size();
+        return idiv_ceil(m_size, 64ULL);
     }
 
     inline bool operator[](size_t i) const {
@@ -104,6 +128,46 @@ public:
     inline size_t size() const {
         return m_size;
     }
+
+    // counts the 1-bits in [begin, end) using the bulk popcount kernel
+    inline size_t popcount(const size_t begin, const size_t end) const {
+        assert(begin <= end && end <= m_size);
+        if(unlikely(begin == end)) return 0;
+
+        const size_t a = block(begin);
+        const size_t b = block(end - 1);
+        const uint64_t mask_a = UINT64_MAX << offset(begin);
+        const uint64_t mask_b = UINT64_MAX >> (63ULL - offset(end - 1));
+        if(a == b) return __builtin_popcountll(m_words[a] & mask_a & mask_b);
+
+        return __builtin_popcountll(m_words[a] & mask_a) +
+               ::stash::popcount(m_words + a + 1, b - a - 1) +
+               __builtin_popcountll(m_words[b] & mask_b);
+    }
+
+    // counts all 1-bits
+    inline size_t popcount() const {
+        return popcount(0, m_size);
+    }
+
+    // counts the 1-bits in each block of block_words words and reports them
+    // by calling f(b, count) for every block b in order, which is meant for
+    // building rank and select directories
+    template<typename func_t>
+    inline void popcount_blocks(const size_t block_words, func_t f) const {
+        ::stash::popcount_blocks(m_words, num_blocks(), block_words, f);
+    }
+
+    // prefetches the memory holding the i-th bit
+    inline void prefetch(size_t i) const {
+        __builtin_prefetch(m_words + block(i));
+    }
+
+    // writes the bit vector so that it can be mapped into memory later
+    inline void write(io::serializer& out) const {
+        out.write(m_size);
+        out.write(m_words, num_blocks());
+    }
 };
 
 }
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <memory>
+#include <vector>
+#include <utility>
+
+#include <stash/io/serialize.hpp>
+#include <stash/util/likely.hpp>
+#include <stash/util/math.hpp>
+#include <stash/vec/bit_unpack.hpp>
+#include <stash/vec/int_vector.hpp>
+#include <stash/vec/util.hpp>
+
+namespace stash {
+
+// an int_vector whose width m_width is known at compile time, so that
+// the shifts and masks of accesses are constants
+//
+// the words are laid out and written exactly as by int_vector, so the two
+// can be converted into each other and either can map what the other wrote
+template<size_t m_width>
+class fixed_int_vector {
+private:
+    static_assert(m_width > 0 && m_width <= 64);
+
+    static constexpr uint64_t m_mask = bit_mask(m_width);
+
+    // entries of widths 8, 16, 32 and 64 are accessed using plain loads and stores
+    static constexpr bool m_aligned = (m_width == 8 || m_width == 16 || m_width == 32 || m_width == 64);
+
+    // entries of widths that divide 64 never span two words
+    static constexpr bool m_single_word = (64ULL % m_width == 0);
+
+    size_t m_size;
+    std::vector<uint64_t> m_data;
+
+    // the words that are read - either m_data or memory in a mapped file,
+    // in which case the vector is read-only and m_mapping keeps the file alive
+    const uint64_t*             m_words;
+    std::shared_ptr<const void> m_mapping;
+
+    inline size_t num_words() const {
+        return idiv_ceil(m_size * m_width, 64ULL);
+    }
+
+    inline void set(const size_t i, uint64_t v) {
+        assert(!m_mapping);
+        if constexpr(m_aligned) {
+            using word_t = typename uint_of_width<m_width>::type;
+            store_word<word_t>(m_data.data(), i, word_t(v));
+        } else {
+            v &= m_mask; // make sure it fits...
+
+            const size_t j = i * m_width;
+            const size_t a = j >> 6ULL;
+            const size_t d = j & 63ULL;
+            m_data[a] = (m_data[a] & ~(m_mask << d)) | (v << d);
+
+            if constexpr(!m_single_word) {
+                if(d + m_width > 64ULL) {
+                    // the high bits of v are the prefix of the next word
+                    const size_t wa = 64ULL - d;
+                    m_data[a + 1] = (m_data[a + 1] & ~(m_mask >> wa)) | (v >> wa);
+                }
+            }
+        }
+    }
+
+    inline uint64_t get(const size_t i) const {
+        if constexpr(m_aligned) {
+            using word_t = typename uint_of_width<m_width>::type;
+            return load_word<word_t>(m_words, i);
+        } else if constexpr(m_single_word) {
+            const size_t j = i * m_width;
+            return (m_words[j >> 6ULL] >> (j & 63ULL)) & m_mask;
+        } else {
+            return bit_unpack::get(m_words, i * m_width, m_width, m_mask);
+        }
+    }
+
+    // writes n entries starting at the i-th, the values of which are
+    // retrieved by calling gen(), collecting them in whole words
+    template<typename gen_t>
+    inline void encode(const size_t i, const size_t n, gen_t gen) {
+        assert(!m_mapping);
+        if(unlikely(n == 0)) return;
+
+        if constexpr(m_aligned) {
+            using word_t = typename uint_of_width<m_width>::type;
+            for(size_t k = 0; k < n; k++) store_word<word_t>(m_data.data(), i + k, word_t(gen()));
+        } else {
+            const size_t j = i * m_width;
+            size_t a = j >> 6ULL;
+            size_t d = j & 63ULL; // number of bits in buf
+
+            uint64_t buf = m_data[a] & bit_mask(d); // keep the preceding entries
+            for(size_t k = 0; k < n; k++) {
+                const uint64_t v = gen() & m_mask;
+                buf |= v << d;
+                d += m_width;
+                if(d >= 64ULL) {
+                    m_data[a++] = buf;
+                    d -= 64ULL;
+                    buf = d ? (v >> (m_width - d)) : 0;
+                }
+            }
+
+            if(d) {
+                // keep the following entries
+                m_data[a] = buf | (m_data[a] & ~bit_mask(d));
+            }
+        }
+    }
+
+public:
+    struct Ref {
+        fixed_int_vector* iv;
+        size_t i;
+
+        inline operator uint64_t() const {
+            return iv->get(i);
+        }
+
+        inline void operator=(uint64_t v) {
+            iv->set(i, v);
+        }
+    };
+
+    inline fixed_int_vector() : m_size(0), m_words(nullptr) {
+    }
+
+    inline fixed_int_vector(const fixed_int_vector& other) {
+        *this = other;
+    }
+
+    inline fixed_int_vector(fixed_int_vector&& other) {
+        *this = std::move(other);
+    }
+
+    inline fixed_int_vector(size_t size) {
+        resize(size);
+    }
+
+    // converts an int_vector - a mapped vector of the same width is shared,
+    // otherwise the entries are copied and, if needed, truncated to m_width bits
+    inline fixed_int_vector(const int_vector& other) {
+        if(other.m_width == m_width && other.m_mapping) {
+            m_size = other.m_size;
+            m_words = other.m_words;
+            m_mapping = other.m_mapping;
+        } else {
+            resize(other.m_size);
+            if(other.m_width == m_width) {
+                std::copy(other.m_words, other.m_words + num_words(), m_data.begin());
+            } else {
+                uint64_t buf[64];
+                for(size_t i = 0; i < m_size; i += 64) {
+                    const size_t k = std::min(m_size - i, size_t(64));
+                    other.decode_block(i, k, buf);
+                    copy_from(buf, buf + k, i);
+                }
+            }
+        }
+    }
+
+    // maps a vector written using write (or by an int_vector of the same width)
+    inline fixed_int_vector(io::mapped_reader& in) {
+        m_size = in.read();
+        in.expect(m_width);
+        m_words = in.read(num_words());
+        m_mapping = in.mapping();
+    }
+
+    inline fixed_int_vector& operator=(const fixed_int_vector& other) {
+        m_size = other.m_size;
+        m_data = other.m_data;
+        m_mapping = other.m_mapping;
+        m_words = m_mapping ? other.m_words : m_data.data();
+        return *this;
+    }
+
+    inline fixed_int_vector& operator=(fixed_int_vector&& other) {
+        m_size = other.m_size;
+        m_data = std::move(other.m_data);
+        m_mapping = std::move(other.m_mapping);
+        m_words = m_mapping ? other.m_words : m_data.data();
+        return *this;
+    }
+
+    // converts into an int_vector of the same width
+    inline operator int_vector() const {
+        int_vector iv;
+        if(m_mapping) {
+            iv.m_size = m_size;
+            iv.m_width = m_width;
+            iv.m_mask = m_mask;
+            iv.m_words = m_words;
+            iv.m_mapping = m_mapping;
+        } else {
+            iv.resize(m_size, m_width);
+            std::copy(m_words, m_words + num_words(), iv.m_data.begin());
+        }
+        return iv;
+    }
+
+    inline void resize(size_t size) {
+        m_size = size;
+        m_data.resize(num_words());
+        m_words = m_data.data();
+        m_mapping.reset();
+    }
+
+    inline uint64_t operator[](size_t i) const {
+        return get(i);
+    }
+
+    inline Ref operator[](size_t i) {
+        return Ref { this, i };
+    }
+
+    inline size_t size() const {
+        return m_size;
+    }
+
+    static constexpr size_t width() {
+        return m_width;
+    }
+
+    // sets the n entries starting at the i-th to v
+    inline void fill(const size_t i, const size_t n, const uint64_t v) {
+        assert(i + n <= m_size);
+        encode(i, n, [v](){ return v; });
+    }
+
+    // sets all entries to v
+    inline void fill(const uint64_t v) {
+        fill(0, m_size, v);
+    }
+
+    // copies the values in [begin, end) into the entries starting at the i-th
+    template<typename iter_t>
+    inline void copy_from(iter_t begin, const iter_t end, const size_t i = 0) {
+        const size_t n = std::distance(begin, end);
+        assert(i + n <= m_size);
+        encode(i, n, [&](){ return uint64_t(*begin++); });
+    }
+
+    // decodes the n entries starting at the i-th into out
+    inline void decode_block(const size_t i, const size_t n, uint64_t* out) const {
+        assert(i + n <= m_size);
+        if constexpr(m_aligned) {
+            for(size_t k = 0; k < n; k++) out[k] = get(i + k);
+        } else {
+            bit_unpack::unpack(m_words, num_words(), i * m_width, m_width, n, out);
+        }
+    }
+
+    // prefetches the memory holding the i-th entry
+    inline void prefetch(size_t i) const {
+        __builtin_prefetch(m_words + ((i * m_width) >> 6ULL));
+    }
+
+    // writes the vector so that it can be mapped into memory later
+    inline void write(io::serializer& out) const {
+        out.write(m_size);
+        out.write(m_width);
+        out.write(m_words, num_words());
+    }
+};
+
+}
@@ -1,20 +1,43 @@
 #pragma once
     
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <memory>
 #include <vector>
 #include <utility>
 
+#include <stash/io/serialize.hpp>
+#include <stash/util/likely.hpp>
+#include <stash/util/math.hpp>
+#include <stash/vec/bit_unpack.hpp>
 #include <stash/vec/util.hpp>
 
 namespace stash {
 
+template<size_t m_width> class fixed_int_vector;
+
 class int_vector {
 private:
+    // shares the layout of the words, see fixed_int_vector.hpp
+    template<size_t m_width> friend class fixed_int_vector;
+
     size_t m_size;
     size_t m_width;
     size_t m_mask;
     std::vector<uint64_t> m_data;
 
+    // the words that are read - either m_data or memory in a mapped file,
+    // in which case the vector is read-only and m_mapping keeps the file alive
+    const uint64_t*             m_words;
+    std::shared_ptr<const void> m_mapping;
+
+    inline size_t num_words() const {
+        return idiv_ceil(m_size * m_width, 64ULL);
+    }
+
     inline void set(size_t i, uint64_t v) {
+        assert(!m_mapping);
         v &= m_mask; // make sure it fits...
         
         const size_t j = i * m_width;
@@ -38,12 +61,7 @@ private:
             m_data[b] = (b_hi << wb) | v_hi;
         } else {
             const size_t dl = j & 63ULL;
-            const size_t dvl = dl + m_width;
-            
-            const uint64_t xa = m_data[a];
-            const uint64_t lo = xa & bit_mask(dl);
-            const uint64_t hi = xa >> dvl;
-            m_data[a] = lo | (v << dl) | (hi << dvl);
+            m_data[a] = (m_data[a] & ~(m_mask << dl)) | (v << dl);
         }
     }
 
@@ -59,15 +77,70 @@ private:
         const size_t wa = 64ULL - da;
 
         // get the wa highest bits from a
-        const uint64_t a_hi = m_data[a] >> da;
+        const uint64_t a_hi = m_words[a] >> da;
 
         // get b (its high bits will be masked away below)
         // NOTE: we could save this step if we knew a == b,
         //       but the branch caused by checking that is too expensive
-        const uint64_t b_lo = m_data[b];
+        const uint64_t b_lo = m_words[b];
+
+        // combine - shifting in two steps avoids an undefined shift by
+        // 64 if da = 0, in which case a == b and b's bits are masked away
+        return (((b_lo << 1ULL) << (wa - 1ULL)) | a_hi) & m_mask;
+    }
+
+    // entries of widths 8, 16, 32 and 64 are aligned to their type,
+    // so they can be accessed using plain loads and stores (little endian)
+    static constexpr bool is_aligned_width(const size_t w) {
+        return w == 8 || w == 16 || w == 32 || w == 64;
+    }
 
-        // combine
-        return ((b_lo << wa) | a_hi) & m_mask;
+    template<size_t m_w>
+    inline void decode_aligned(const size_t i, const size_t n, uint64_t* out) const {
+        using word_t = typename uint_of_width<m_w>::type;
+        for(size_t k = 0; k < n; k++) out[k] = load_word<word_t>(m_words, i + k);
+    }
+
+    template<size_t m_w, typename gen_t>
+    inline void encode_aligned(const size_t i, const size_t n, gen_t gen) {
+        using word_t = typename uint_of_width<m_w>::type;
+        for(size_t k = 0; k < n; k++) store_word<word_t>(m_data.data(), i + k, word_t(gen()));
+    }
+
+    // writes n entries starting at the i-th, the values of which are
+    // retrieved by calling gen(), collecting them in whole words
+    template<typename gen_t>
+    inline void encode(const size_t i, const size_t n, gen_t gen) {
+        assert(!m_mapping);
+        if(unlikely(n == 0 || m_width == 0)) return;
+
+        switch(m_width) {
+            case 8:  encode_aligned<8>(i, n, gen); return;
+            case 16: encode_aligned<16>(i, n, gen); return;
+            case 32: encode_aligned<32>(i, n, gen); return;
+            case 64: encode_aligned<64>(i, n, gen); return;
+        }
+
+        const size_t j = i * m_width;
+        size_t a = j >> 6ULL;
+        size_t d = j & 63ULL; // number of bits in buf
+
+        uint64_t buf = m_data[a] & bit_mask(d); // keep the preceding entries
+        for(size_t k = 0; k < n; k++) {
+            const uint64_t v = gen() & m_mask;
+            buf |= v << d;
+            d += m_width;
+            if(d >= 64ULL) {
+                m_data[a++] = buf;
+                d -= 64ULL;
+                buf = d ? (v >> (m_width - d)) : 0;
+            }
+        }
+
+        if(d) {
+            // keep the following entries
+            m_data[a] = buf | (m_data[a] & ~bit_mask(d));
+        }
     }
 
 public:
@@ -84,7 +157,7 @@ public:
         }
     };
 
-    inline int_vector() : m_size(0), m_width(0), m_mask(0) {
+    inline int_vector() : m_size(0), m_width(0), m_mask(0), m_words(nullptr) {
     }
 
     inline int_vector(const int_vector& other) {
@@ -99,11 +172,22 @@ public:
         resize(size, width);
     }
 
+    // maps a vector written using write
+    inline int_vector(io::mapped_reader& in) {
+        m_size = in.read();
+        m_width = in.read();
+        m_mask = bit_mask(m_width);
+        m_words = in.read(num_words());
+        m_mapping = in.mapping();
+    }
+
     inline int_vector& operator=(const int_vector& other) {
         m_size = other.m_size;
         m_width = other.m_width;
         m_mask = other.m_mask;
         m_data = other.m_data;
+        m_mapping = other.m_mapping;
+        m_words = m_mapping ? other.m_words : m_data.data();
         return *this;
     }
 
@@ -112,6 +196,8 @@ public:
         m_width = other.m_width;
         m_mask = other.m_mask;
         m_data = std::move(other.m_data);
+        m_mapping = std::move(other.m_mapping);
+        m_words = m_mapping ? other.m_words : m_data.data();
         return *this;
     }
 
@@ -124,18 +210,28 @@ public:
         const size_t q = bits >> 6ULL; // divide by 64
         const size_t k = bits & 63ULL; // mod 64
         m_data.resize(k ? q + 1 : q);
+        m_words = m_data.data();
+        m_mapping.reset();
     }
 
     inline void rebuild(size_t size, size_t width) {
         int_vector new_iv(size, width);
-        for(size_t i = 0; i < size; i++) {
-            new_iv.set(i, get(i));
+
+        // transfer the entries in blocks
+        uint64_t buf[64];
+        const size_t n = std::min(size, m_size);
+        for(size_t i = 0; i < n; i += 64) {
+            const size_t k = std::min(n - i, size_t(64));
+            decode_block(i, k, buf);
+            new_iv.copy_from(buf, buf + k, i);
         }
         
         m_size = new_iv.m_size;
         m_width = new_iv.m_width;
         m_mask = new_iv.m_mask;
         m_data = std::move(new_iv.m_data);
+        m_words = m_data.data();
+        m_mapping.reset();
     }
 
     inline void rebuild(size_t size) {
@@ -153,6 +249,166 @@ public:
     inline size_t size() const {
         return m_size;
     }
+
+    inline size_t width() const {
+        return m_width;
+    }
+
+    // gets the i-th entry, where the width is known to be m_w at compile
+    // time - entries of widths 8, 16, 32 and 64 are read using plain loads,
+    // and those of other widths that divide 64 using constant shifts
+    template<size_t m_w>
+    inline uint64_t get_fixed(const size_t i) const {
+        static_assert(m_w > 0 && m_w <= 64);
+        assert(m_width == m_w);
+        if constexpr(is_aligned_width(m_w)) {
+            using word_t = typename uint_of_width<m_w>::type;
+            return load_word<word_t>(m_words, i);
+        } else if constexpr(64ULL % m_w == 0) {
+            const size_t j = i * m_w;
+            return (m_words[j >> 6ULL] >> (j & 63ULL)) & bit_mask(m_w);
+        } else {
+            // entries may span two words, for which constant shifts do not help
+            return get(i);
+        }
+    }
+
+    // sets the i-th entry to v, where the width is known to be m_w at compile
+    // time - entries of widths 8, 16, 32 and 64 are written using plain stores
+    template<size_t m_w>
+    inline void set_fixed(const size_t i, const uint64_t v) {
+        static_assert(m_w > 0 && m_w <= 64);
+        assert(m_width == m_w);
+        assert(!m_mapping);
+        if constexpr(is_aligned_width(m_w)) {
+            using word_t = typename uint_of_width<m_w>::type;
+            store_word<word_t>(m_data.data(), i, word_t(v));
+        } else {
+            set(i, v);
+        }
+    }
+
+    // sets the n entries starting at the i-th to v
+    inline void fill(const size_t i, const size_t n, const uint64_t v) {
+        assert(i + n <= m_size);
+        encode(i, n, [v](){ return v; });
+    }
+
+    // sets all entries to v
+    inline void fill(const uint64_t v) {
+        fill(0, m_size, v);
+    }
+
+    // copies the values in [begin, end) into the entries starting at the i-th
+    template<typename iter_t>
+    inline void copy_from(iter_t begin, const iter_t end, const size_t i = 0) {
+        const size_t n = std::distance(begin, end);
+        assert(i + n <= m_size);
+        encode(i, n, [&](){ return uint64_t(*begin++); });
+    }
+
+    // decodes the n entries starting at the i-th into out - entries of widths
+    // 8, 16, 32 and 64 are loaded directly, and others are unpacked using
+    // the SIMD kernels in bit_unpack.hpp
+    inline void decode_block(const size_t i, const size_t n, uint64_t* out) const {
+        assert(i + n <= m_size);
+        switch(m_width) {
+            case 0:  std::fill(out, out + n, 0); return;
+            case 8:  decode_aligned<8>(i, n, out); return;
+            case 16: decode_aligned<16>(i, n, out); return;
+            case 32: decode_aligned<32>(i, n, out); return;
+            case 64: decode_aligned<64>(i, n, out); return;
+        }
+
+        bit_unpack::unpack(m_words, num_words(), i * m_width, m_width, n, out);
+    }
+
+    // a sequential scan over the entries in [begin, end), which decodes
+    // blocks of entries into a buffer using decode_block - the block size
+    // depends on the unpacking kernel selected at runtime
+    class scan_range {
+    private:
+        const int_vector* m_iv;
+        size_t m_begin;
+        size_t m_end;
+        size_t m_block;
+        size_t m_buf_begin; // the index of the first buffered entry
+        uint64_t m_buf[bit_unpack::MAX_BLOCK];
+
+        inline void load(const size_t i) {
+            m_buf_begin = i;
+            m_iv->decode_block(i, std::min(m_end - i, m_block), m_buf);
+        }
+
+    public:
+        class iterator {
+        private:
+            scan_range* m_range;
+            size_t m_i;
+
+        public:
+            inline iterator(scan_range* range, const size_t i) : m_range(range), m_i(i) {
+            }
+
+            inline uint64_t operator*() const {
+                return m_range->m_buf[m_i - m_range->m_buf_begin];
+            }
+
+            inline iterator& operator++() {
+                ++m_i;
+                if(unlikely(m_i - m_range->m_buf_begin == m_range->m_block) && m_i < m_range->m_end) {
+                    m_range->load(m_i);
+                }
+                return *this;
+            }
+
+            inline bool operator==(const iterator& other) const {
+                return m_i == other.m_i;
+            }
+
+            inline bool operator!=(const iterator& other) const {
+                return m_i != other.m_i;
+            }
+        };
+
+        inline scan_range(const int_vector& iv, const size_t begin, const size_t end)
+            : m_iv(&iv), m_begin(begin), m_end(end), m_block(bit_unpack::block_size()), m_buf_begin(begin) {
+
+            assert(begin <= end && end <= iv.size());
+            assert(m_block <= bit_unpack::MAX_BLOCK);
+        }
+
+        inline iterator begin() {
+            if(m_begin < m_end) load(m_begin);
+            return iterator(this, m_begin);
+        }
+
+        inline iterator end() {
+            return iterator(this, m_end);
+        }
+    };
+
+    // scans the entries in [begin, end), e.g., using a range-based for loop
+    inline scan_range scan(const size_t begin, const size_t end) const {
+        return scan_range(*this, begin, end);
+    }
+
+    // scans all entries
+    inline scan_range scan() const {
+        return scan(0, m_size);
+    }
+
+    // prefetches the memory holding the i-th entry
+    inline void prefetch(size_t i) const {
+        __builtin_prefetch(m_words + ((i * m_width) >> 6ULL));
+    }
+
+    // writes the vector so that it can be mapped into memory later
+    inline void write(io::serializer& out) const {
+        out.write(m_size);
+        out.write(m_width);
+        out.write(m_words, num_words());
+    }
 };
 
 }
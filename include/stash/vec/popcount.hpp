@@ -0,0 +1,271 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <stash/util/cpu.hpp>
+
+namespace stash {
+
+// bulk popcount kernels over arrays of words
+//
+// the kernel is chosen at runtime (see cpu.hpp): AVX-512 VPOPCNTDQ, AVX2
+// (Harley-Seal with Mula's nibble lookup, see github/WojciechMula/sse-popcount),
+// the popcnt instruction with four independent counters, or a portable fallback
+namespace popcount_kernels {
+
+// portable kernel
+inline size_t count_scalar(const uint64_t* words, const size_t n) {
+    size_t r = 0;
+    for(size_t i = 0; i < n; i++) r += __builtin_popcountll(words[i]);
+    return r;
+}
+
+inline void count_words_scalar(const uint64_t* words, const size_t n, uint8_t* out) {
+    for(size_t i = 0; i < n; i++) out[i] = __builtin_popcountll(words[i]);
+}
+
+#ifdef STASH_X86
+// popcnt kernel, four words per step to hide the instruction's latency
+STASH_TARGET("popcnt")
+inline size_t count_popcnt(const uint64_t* words, const size_t n) {
+    size_t r0 = 0, r1 = 0, r2 = 0, r3 = 0;
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4) {
+        r0 += __builtin_popcountll(words[i]);
+        r1 += __builtin_popcountll(words[i+1]);
+        r2 += __builtin_popcountll(words[i+2]);
+        r3 += __builtin_popcountll(words[i+3]);
+    }
+    for(; i < n; i++) r0 += __builtin_popcountll(words[i]);
+    return r0 + r1 + r2 + r3;
+}
+
+STASH_TARGET("popcnt")
+inline void count_words_popcnt(const uint64_t* words, const size_t n, uint8_t* out) {
+    for(size_t i = 0; i < n; i++) out[i] = __builtin_popcountll(words[i]);
+}
+
+// popcount of each byte using a lookup of nibbles
+STASH_TARGET("avx2")
+inline __m256i popcount_bytes_avx2(const __m256i v) {
+    const __m256i lookup = _mm256_setr_epi8(
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0F);
+
+    const __m256i lo = _mm256_and_si256(v, low);
+    const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low);
+    return _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+}
+
+// popcount of each 64-bit lane
+STASH_TARGET("avx2")
+inline __m256i popcount_u64_avx2(const __m256i v) {
+    return _mm256_sad_epu8(popcount_bytes_avx2(v), _mm256_setzero_si256());
+}
+
+// carry-save adder
+STASH_TARGET("avx2")
+inline void csa_avx2(__m256i& h, __m256i& l, const __m256i a, const __m256i b, const __m256i c) {
+    const __m256i u = _mm256_xor_si256(a, b);
+    h = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(u, c));
+    l = _mm256_xor_si256(u, c);
+}
+
+// AVX2 kernel - a Harley-Seal tree of carry-save adders reduces 16 vectors
+// into one of weight 16, so only every 16th vector is actually popcounted
+STASH_TARGET("avx2")
+inline size_t count_avx2(const uint64_t* words, const size_t n) {
+    const __m256i* v = (const __m256i*)words;
+    const size_t num_vectors = n / 4;
+
+    __m256i total = _mm256_setzero_si256();
+    __m256i ones = _mm256_setzero_si256();
+    __m256i twos = _mm256_setzero_si256();
+    __m256i fours = _mm256_setzero_si256();
+    __m256i eights = _mm256_setzero_si256();
+    __m256i sixteens, twos_a, twos_b, fours_a, fours_b, eights_a, eights_b;
+
+    size_t i = 0;
+    for(; i + 16 <= num_vectors; i += 16) {
+        #define LOAD(k) _mm256_loadu_si256(v + i + k)
+        csa_avx2(twos_a, ones, ones, LOAD(0), LOAD(1));
+        csa_avx2(twos_b, ones, ones, LOAD(2), LOAD(3));
+        csa_avx2(fours_a, twos, twos, twos_a, twos_b);
+        csa_avx2(twos_a, ones, ones, LOAD(4), LOAD(5));
+        csa_avx2(twos_b, ones, ones, LOAD(6), LOAD(7));
+        csa_avx2(fours_b, twos, twos, twos_a, twos_b);
+        csa_avx2(eights_a, fours, fours, fours_a, fours_b);
+        csa_avx2(twos_a, ones, ones, LOAD(8), LOAD(9));
+        csa_avx2(twos_b, ones, ones, LOAD(10), LOAD(11));
+        csa_avx2(fours_a, twos, twos, twos_a, twos_b);
+        csa_avx2(twos_a, ones, ones, LOAD(12), LOAD(13));
+        csa_avx2(twos_b, ones, ones, LOAD(14), LOAD(15));
+        csa_avx2(fours_b, twos, twos, twos_a, twos_b);
+        csa_avx2(eights_b, fours, fours, fours_a, fours_b);
+        csa_avx2(sixteens, eights, eights, eights_a, eights_b);
+        #undef LOAD
+
+        total = _mm256_add_epi64(total, popcount_u64_avx2(sixteens));
+    }
+
+    total = _mm256_slli_epi64(total, 4);
+    total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount_u64_avx2(eights), 3));
+    total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount_u64_avx2(fours), 2));
+    total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount_u64_avx2(twos), 1));
+    total = _mm256_add_epi64(total, popcount_u64_avx2(ones));
+
+    for(; i < num_vectors; i++) {
+        total = _mm256_add_epi64(total, popcount_u64_avx2(_mm256_loadu_si256(v + i)));
+    }
+
+    size_t r = _mm256_extract_epi64(total, 0) + _mm256_extract_epi64(total, 1) +
+               _mm256_extract_epi64(total, 2) + _mm256_extract_epi64(total, 3);
+
+    for(size_t j = num_vectors * 4; j < n; j++) r += __builtin_popcountll(words[j]);
+    return r;
+}
+
+STASH_TARGET("avx2")
+inline void count_words_avx2(const uint64_t* words, const size_t n, uint8_t* out) {
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4) {
+        const __m256i c = popcount_u64_avx2(_mm256_loadu_si256((const __m256i*)(words + i)));
+
+        // gather the lowest byte of each lane
+        const __m256i b = _mm256_shuffle_epi8(c, _mm256_setr_epi8(
+            0, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            0, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+        const uint16_t lo = _mm256_extract_epi16(b, 0);
+        const uint16_t hi = _mm256_extract_epi16(b, 8);
+        out[i]   = uint8_t(lo);
+        out[i+1] = uint8_t(lo >> 8);
+        out[i+2] = uint8_t(hi);
+        out[i+3] = uint8_t(hi >> 8);
+    }
+    for(; i < n; i++) out[i] = __builtin_popcountll(words[i]);
+}
+
+// AVX-512 kernel using VPOPCNTDQ, which popcounts eight words at once
+STASH_SUPPRESS_UNINITIALIZED_BEGIN
+STASH_TARGET("avx512f,avx512vpopcntdq")
+inline size_t count_avx512(const uint64_t* words, const size_t n) {
+    __m512i acc0 = _mm512_setzero_si512();
+    __m512i acc1 = _mm512_setzero_si512();
+
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16) {
+        acc0 = _mm512_add_epi64(acc0, _mm512_popcnt_epi64(_mm512_loadu_si512(words + i)));
+        acc1 = _mm512_add_epi64(acc1, _mm512_popcnt_epi64(_mm512_loadu_si512(words + i + 8)));
+    }
+    if(i + 8 <= n) {
+        acc0 = _mm512_add_epi64(acc0, _mm512_popcnt_epi64(_mm512_loadu_si512(words + i)));
+        i += 8;
+    }
+    if(i < n) {
+        // masked load of the remaining words
+        const __mmask8 m = __mmask8((1U << (n - i)) - 1U);
+        acc1 = _mm512_add_epi64(acc1, _mm512_popcnt_epi64(_mm512_maskz_loadu_epi64(m, words + i)));
+    }
+    return _mm512_reduce_add_epi64(_mm512_add_epi64(acc0, acc1));
+}
+
+STASH_TARGET("avx512f,avx512vpopcntdq")
+inline void count_words_avx512(const uint64_t* words, const size_t n, uint8_t* out) {
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        const __m512i c = _mm512_popcnt_epi64(_mm512_loadu_si512(words + i));
+        _mm_storel_epi64((__m128i*)(out + i), _mm512_cvtepi64_epi8(c));
+    }
+    for(; i < n; i++) out[i] = __builtin_popcountll(words[i]);
+}
+STASH_SUPPRESS_UNINITIALIZED_END
+#endif
+
+// a set of kernels
+struct kernel {
+    const char* name;
+    size_t (*count)(const uint64_t*, size_t);
+    void (*count_words)(const uint64_t*, size_t, uint8_t*);
+};
+
+// selects the best kernel supported by the CPU
+inline kernel select() {
+    #ifdef STASH_X86
+    if(cpu::has_avx512vpopcntdq()) return kernel { "avx512", count_avx512, count_words_avx512 };
+    if(cpu::has_avx2())            return kernel { "avx2", count_avx2, count_words_avx2 };
+    if(cpu::has_popcnt())          return kernel { "popcnt", count_popcnt, count_words_popcnt };
+    #endif
+    return kernel { "scalar", count_scalar, count_words_scalar };
+}
+
+// the selected kernel, determined on first use
+inline const kernel& get() {
+    static const kernel k = select();
+    return k;
+}
+
+}
+
+// the name of the popcount kernel in use
+inline const char* popcount_kernel() {
+    return popcount_kernels::get().name;
+}
+
+// counts the 1-bits in the n given words
+inline size_t popcount(const uint64_t* words, const size_t n) {
+    return popcount_kernels::get().count(words, n);
+}
+
+// stores the number of 1-bits of each of the n given words into out
+inline void popcount_words(const uint64_t* words, const size_t n, uint8_t* out) {
+    popcount_kernels::get().count_words(words, n, out);
+}
+
+// counts the 1-bits in each block of block_words consecutive words (the last
+// block may be shorter) and reports them by calling f(b, count) for every
+// block b in order - this is the bulk step of building rank and select
+// directories, and the words are counted in chunks using popcount_words
+template<typename func_t>
+inline void popcount_blocks(const uint64_t* words, const size_t n, const size_t block_words, func_t f) {
+    #ifdef __POPCNT__
+    if(block_words == 1) {
+        // the popcnt instruction we were compiled for is as fast for single words
+        for(size_t i = 0; i < n; i++) f(i, size_t(__builtin_popcountll(words[i])));
+        return;
+    }
+    #endif
+
+    constexpr size_t CHUNK = 4096;
+    const size_t chunk = std::max(size_t(1), CHUNK / block_words) * block_words;
+
+    uint8_t counts[CHUNK];
+    uint8_t* buf = counts;
+    std::unique_ptr<uint8_t[]> large;
+    if(chunk > CHUNK) {
+        large = std::unique_ptr<uint8_t[]>(new uint8_t[chunk]);
+        buf = large.get();
+    }
+
+    size_t b = 0;
+    for(size_t i = 0; i < n; i += chunk) {
+        const size_t k = std::min(n - i, chunk);
+        popcount_words(words + i, k, buf);
+        if(block_words == 1) {
+            for(size_t j = 0; j < k; j++) f(b++, size_t(buf[j]));
+            continue;
+        }
+
+        for(size_t j = 0; j < k; j += block_words) {
+            const size_t e = std::min(j + block_words, k);
+            size_t c = 0;
+            for(size_t l = j; l < e; l++) c += buf[l];
+            f(b++, c);
+        }
+    }
+}
+
+}
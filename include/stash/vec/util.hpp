@@ -1,12 +1,38 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
+#include <stash/util/cpu.hpp>
+
 namespace stash {
 
 // creates a mask consisting of the given number of bits
 inline constexpr uint64_t bit_mask(uint64_t bits) {
-    return (1ULL << bits) - 1ULL;
+    return (bits >= 64ULL) ? UINT64_MAX : (1ULL << bits) - 1ULL;
+}
+
+// the unsigned integer type of exactly the given number of bits, if any
+template<size_t m_bits> struct uint_of_width {};
+template<> struct uint_of_width<8>  { using type = uint8_t; };
+template<> struct uint_of_width<16> { using type = uint16_t; };
+template<> struct uint_of_width<32> { using type = uint32_t; };
+template<> struct uint_of_width<64> { using type = uint64_t; };
+
+// reads the i-th value of type word_t from an array of words - copying it
+// rather than reading through a word_t pointer into the words avoids
+// aliasing them, and compiles to the same load
+template<typename word_t>
+inline word_t load_word(const uint64_t* words, const size_t i) {
+    word_t v;
+    __builtin_memcpy(&v, (const char*)words + i * sizeof(word_t), sizeof(word_t));
+    return v;
+}
+
+// writes the i-th value of type word_t into an array of words
+template<typename word_t>
+inline void store_word(uint64_t* words, const size_t i, const word_t v) {
+    __builtin_memcpy((char*)words + i * sizeof(word_t), &v, sizeof(word_t));
 }
 
 // rank on a 64-bit value
@@ -39,7 +65,31 @@ constexpr uint8_t SELECT_FAIL = 0xFF;
 /// \param k the searched 1-bit
 /// \return the position of the k-th 1-bit (LSBF and zero-based),
 ///         or \ref SELECT_FAIL if no such bit exists
+inline uint8_t select1_u64_broadword(uint64_t v, uint8_t k);
+
+#ifdef STASH_X86
+/// \brief BMI2 form of \ref select1_u64, which deposits a single bit at the
+///        position of the k-th 1-bit - only to be called if the CPU has BMI2.
+STASH_TARGET("bmi2")
+inline uint8_t select1_u64_bmi2(uint64_t v, uint8_t k) {
+    return __builtin_ctzll(_pdep_u64(1ULL << (k - 1), v));
+}
+#endif
+
 inline constexpr uint8_t select1_u64(uint64_t v, uint8_t k) {
+    if(!__builtin_is_constant_evaluated()) {
+        if(k == 0 || k > rank1_u64(v)) return SELECT_FAIL;
+        #ifdef __BMI2__
+        // deposit a single bit at the position of the k-th 1-bit (inlined)
+        return __builtin_ctzll(_pdep_u64(1ULL << (k - 1), v));
+        #else
+        #ifdef STASH_X86
+        if(cpu::has_bmi2()) return select1_u64_bmi2(v, k);
+        #endif
+        return select1_u64_broadword(v, k);
+        #endif
+    }
+
     uint8_t pos = 0;
     while(v && k && pos < 64) {
         const size_t z = __builtin_ctzll(v)+1;
@@ -50,6 +100,45 @@ inline constexpr uint8_t select1_u64(uint64_t v, uint8_t k) {
     return k ? SELECT_FAIL : pos - 1;
 }
 
+/// \brief The name of the kernel used by \ref select1_u64 at runtime.
+inline const char* select_kernel() {
+    #ifdef __BMI2__
+    return "bmi2";
+    #elif defined(STASH_X86)
+    return cpu::has_bmi2() ? "bmi2" : "broadword";
+    #else
+    return "broadword";
+    #endif
+}
+
+/// \brief Broadword form of \ref select1_u64 for CPUs without BMI2.
+///
+/// Computes the prefix sums of the bytes' popcounts in parallel to find
+/// the byte containing the k-th 1-bit, which is then searched directly
+/// (see Vigna, "Broadword Implementation of Rank/Select Queries").
+///
+/// \param v the input value
+/// \param k the searched 1-bit, which must exist
+/// \return the position of the k-th 1-bit (LSBF and zero-based)
+inline uint8_t select1_u64_broadword(uint64_t v, uint8_t k) {
+    constexpr uint64_t L8 = 0x0101010101010101ULL;
+    constexpr uint64_t H8 = 0x8080808080808080ULL;
+
+    // the j-th byte of s is the number of 1-bits in bytes 0 through j
+    uint64_t s = v - ((v >> 1ULL) & 0x5555555555555555ULL);
+    s = (s & 0x3333333333333333ULL) + ((s >> 2ULL) & 0x3333333333333333ULL);
+    s = ((s + (s >> 4ULL)) & 0x0F0F0F0F0F0F0F0FULL) * L8;
+
+    // the first byte whose prefix sum is at least k has its high bit set
+    // after adding 128 - k, which cannot overflow into the next byte
+    const uint64_t j = __builtin_ctzll((s + (128ULL - k) * L8) & H8) & ~7ULL;
+    k -= uint8_t((s << 8ULL) >> j);
+
+    uint64_t b = (v >> j) & 0xFFULL;
+    while(--k) b &= b - 1ULL;
+    return j + __builtin_ctzll(b);
+}
+
 /// \brief Finds the position of the k-th 1-bit in the binary representation
 ///        of the given value.
 ///
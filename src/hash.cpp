@@ -2,7 +2,10 @@
 #include <cstdint>
 #include <cassert>
 #include <iostream>
+#include <type_traits>
 
+#include <stash/hash/flat_table.hpp>
+#include <stash/hash/swiss_set.hpp>
 #include <stash/hash/table.hpp>
 #include <stash/hash/linear_probing.hpp>
 #include <stash/hash/quadratic_probing.hpp>
@@ -59,7 +62,7 @@ size_t mix(uint64_t key) {
 struct mul_hash {
     uint64_t prime;
 
-    inline size_t operator()(uint64_t key) {
+    inline size_t operator()(uint64_t key) const {
         return key * prime;
     }
 };
@@ -74,12 +77,32 @@ struct params {
     uint64_t universe = UINT32_MAX;
 };
 
-template<typename hash_func_t, typename probe_func_t>
+// mix as a function object, so that it can be inlined into flat_table
+struct mix_hash {
+    inline size_t operator()(uint64_t key) const {
+        return mix(key);
+    }
+};
+
+// tests whether a hash table supports erase
+template<typename table_t, typename = void>
+struct has_erase : std::false_type {};
+
+template<typename table_t>
+struct has_erase<table_t, std::void_t<decltype(
+    std::declval<table_t&>().erase(uint64_t()))>> : std::true_type {};
+
+// the number of rounds of churn, each replacing a different fraction of
+// 1/CHURN_ROUNDS of the keys
+constexpr size_t CHURN_ROUNDS = 4;
+
+// benchmarks the table constructed by make()
+template<typename make_func_t>
 void test(
-    const std::string& name, hash_func_t hfunc, probe_func_t pfunc, const params& p, const std::vector<uint64_t>& keys, const std::vector<uint64_t>& queries) {
+    const std::string& table, const std::string& name, make_func_t make, const params& p, const std::vector<uint64_t>& keys, const std::vector<uint64_t>& queries) {
 
     malloc_callback::reset();
-    hash::table<uint64_t> h(hfunc, p.capacity, p.load_factor, p.growth_factor, pfunc);
+    auto h = make();
     
     uint64_t t_insert;
 
@@ -124,8 +147,37 @@ void test(
         #endif
     }
 
+    // churn - in every round, erase a different fraction of the keys and
+    // insert new keys in their place (shifted out of the universe, so they
+    // are distinct), which leaves tombstones that eventually force the table
+    // to be rebuilt - the contents are checked after each round
+    constexpr bool churn = has_erase<decltype(h)>::value;
+    uint64_t t_churn = 0;
+    bool churn_ok = true;
+    if constexpr(churn) {
+        std::vector<uint64_t> current(keys);
+        for(size_t r = 0; r < CHURN_ROUNDS; r++) {
+            const auto t0 = time();
+            for(size_t i = r; i < current.size(); i += CHURN_ROUNDS) {
+                churn_ok &= h.erase(current[i]);
+                current[i] += p.universe;
+                h.insert(current[i]);
+            }
+            t_churn += time() - t0;
+
+            churn_ok &= (h.size() == keys.size());
+            for(size_t i = 0; i < keys.size(); i++) {
+                churn_ok &= h.contains(current[i]);
+                if(current[i] != keys[i]) {
+                    churn_ok &= !h.contains(current[i] - p.universe);
+                }
+            }
+        }
+    }
+
     std::cout
         << "RESULT"
+        << " table=" << table
         << " hfunc=" << name
         << " m=" << m
         << " t_insert=" << t_insert
@@ -137,6 +189,12 @@ void test(
         << " e_member=" << e_member;
     #endif
 
+    if constexpr(churn) {
+        std::cout
+            << " t_churn=" << t_churn
+            << " check=" << (churn_ok ? "ok" : "FAIL");
+    }
+
     std::cout
         << " q=" << p.num_queries
         << " chk=" << chksum
@@ -166,6 +224,11 @@ int main(int argc, char** argv) {
         return -1;
     }
 
+    if(p.universe > UINT64_MAX / (CHURN_ROUNDS + 1)) {
+        std::cerr << "the universe is too large" << std::endl;
+        return -1;
+    }
+
     auto keys    = random::permutation(p.universe, 147).vector(p.num_keys);
     auto queries = random::permutation(p.num_keys, 148).vector(p.num_queries);
 
@@ -173,17 +236,50 @@ int main(int argc, char** argv) {
         p.capacity = keys.size();
     }
 
-    test("lp.knuth     ", mul_hash{2654435761ULL},                 hash::linear_probing<>{}, p, keys, queries);
-    test("lp.mul_prime1", mul_hash{15'425'459'083'914'370'367ULL}, hash::linear_probing<>{}, p, keys, queries);
-    test("lp.mul_prime2", mul_hash{16'568'458'216'213'224'001ULL}, hash::linear_probing<>{}, p, keys, queries);
-    test("lp.mul_prime3", mul_hash{17'406'548'584'874'384'839ULL}, hash::linear_probing<>{}, p, keys, queries);
-    test("lp.mix       ", mix,                                     hash::linear_probing<>{}, p, keys, queries);
-    
-    test("qp.knuth     ", mul_hash{2654435761ULL},                 hash::quadratic_probing<>{}, p, keys, queries);
-    test("qp.mul_prime1", mul_hash{15'425'459'083'914'370'367ULL}, hash::quadratic_probing<>{}, p, keys, queries);
-    test("qp.mul_prime2", mul_hash{16'568'458'216'213'224'001ULL}, hash::quadratic_probing<>{}, p, keys, queries);
-    test("qp.mul_prime3", mul_hash{17'406'548'584'874'384'839ULL}, hash::quadratic_probing<>{}, p, keys, queries);
-    test("qp.mix       ", mix,                                     hash::quadratic_probing<>{}, p, keys, queries);
-    
+    // round the capacity up to a power of two, which the flat tables with
+    // pow2 reduction would do anyway, so all tables are compared at equal load
+    p.capacity = hash::pow2_reduce{}.init(p.capacity);
+
+    // compares table against flat_table with either reduction
+    auto test_all = [&](const std::string& name, auto hfunc, auto pfunc){
+        using hash_func_t = decltype(hfunc);
+        using probe_func_t = decltype(pfunc);
+
+        test("table          ", name, [&](){
+            return hash::table<uint64_t>(hfunc, p.capacity, p.load_factor, p.growth_factor, pfunc);
+        }, p, keys, queries);
+        test("flat.pow2      ", name, [&](){
+            return hash::flat_table<uint64_t, hash_func_t, probe_func_t, hash::pow2_reduce>(hfunc, p.capacity, p.load_factor, p.growth_factor, pfunc);
+        }, p, keys, queries);
+        test("flat.fastrange ", name, [&](){
+            return hash::flat_table<uint64_t, hash_func_t, probe_func_t, hash::fastrange_reduce>(hfunc, p.capacity, p.load_factor, p.growth_factor, pfunc);
+        }, p, keys, queries);
+    };
+
+    // SwissTable-style set, which always probes groups in triangular order
+    auto test_swiss = [&](const std::string& name, auto hfunc){
+        test("swiss          ", name, [&](){
+            return hash::swiss_set<uint64_t, decltype(hfunc)>(hfunc, p.capacity, p.load_factor, p.growth_factor);
+        }, p, keys, queries);
+    };
+
+    test_all("lp.knuth     ", mul_hash{2654435761ULL},                 hash::linear_probing<>{});
+    test_all("lp.mul_prime1", mul_hash{15'425'459'083'914'370'367ULL}, hash::linear_probing<>{});
+    test_all("lp.mul_prime2", mul_hash{16'568'458'216'213'224'001ULL}, hash::linear_probing<>{});
+    test_all("lp.mul_prime3", mul_hash{17'406'548'584'874'384'839ULL}, hash::linear_probing<>{});
+    test_all("lp.mix       ", mix_hash{},                              hash::linear_probing<>{});
+
+    test_all("qp.knuth     ", mul_hash{2654435761ULL},                 hash::quadratic_probing<>{});
+    test_all("qp.mul_prime1", mul_hash{15'425'459'083'914'370'367ULL}, hash::quadratic_probing<>{});
+    test_all("qp.mul_prime2", mul_hash{16'568'458'216'213'224'001ULL}, hash::quadratic_probing<>{});
+    test_all("qp.mul_prime3", mul_hash{17'406'548'584'874'384'839ULL}, hash::quadratic_probing<>{});
+    test_all("qp.mix       ", mix_hash{},                              hash::quadratic_probing<>{});
+
+    test_swiss("gp.knuth     ", mul_hash{2654435761ULL});
+    test_swiss("gp.mul_prime1", mul_hash{15'425'459'083'914'370'367ULL});
+    test_swiss("gp.mul_prime2", mul_hash{16'568'458'216'213'224'001ULL});
+    test_swiss("gp.mul_prime3", mul_hash{17'406'548'584'874'384'839ULL});
+    test_swiss("gp.mix       ", mix_hash{});
+
     return 0;
 }
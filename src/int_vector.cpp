@@ -0,0 +1,169 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <tlx/cmdline_parser.hpp>
+
+#include <stash/vec/bit_unpack.hpp>
+#include <stash/vec/fixed_int_vector.hpp>
+#include <stash/vec/int_vector.hpp>
+#include <stash/util/time.hpp>
+
+using namespace stash;
+
+// the number of entries decoded per call of decode_block
+constexpr size_t BLOCK = 64;
+
+// prevents the compiler from optimizing away the benchmarked loops
+volatile uint64_t sink;
+
+// measures the time in milliseconds for f()
+template<typename func_t>
+uint64_t measure(func_t f) {
+    const auto t0 = time();
+    f();
+    return time() - t0;
+}
+
+// gets single entries, sequentially and at the given random positions,
+// from a copy of iv with the width fixed at compile time, and sequentially
+// from iv itself using get_fixed
+template<size_t m_width>
+void measure_fixed(
+    const int_vector& iv, const std::vector<size_t>& queries,
+    uint64_t& sum, uint64_t& sum_rand, uint64_t& sum_iv, uint64_t& t, uint64_t& t_rand, uint64_t& t_iv) {
+
+    const fixed_int_vector<m_width> fv(iv);
+
+    // sum into locals, which cannot alias the entries
+    uint64_t s = 0, s_rand = 0, s_iv = 0;
+    t_iv = measure([&](){
+        for(size_t i = 0; i < iv.size(); i++) s_iv += iv.get_fixed<m_width>(i);
+    });
+    t = measure([&](){
+        for(size_t i = 0; i < fv.size(); i++) s += fv[i];
+    });
+    t_rand = measure([&](){
+        for(const size_t i : queries) s_rand += fv[i & ~(s_rand & 1)];
+    });
+    sum = s;
+    sum_rand = s_rand;
+    sum_iv = s_iv;
+}
+
+void bench(const size_t n, const size_t w, const std::vector<uint64_t>& values, const std::vector<size_t>& queries) {
+    int_vector iv(n, w);
+
+    // set single entries
+    const uint64_t t_set = measure([&](){
+        for(size_t i = 0; i < n; i++) iv[i] = values[i];
+    });
+
+    // get single entries
+    uint64_t sum_get = 0;
+    const uint64_t t_get = measure([&](){
+        for(size_t i = 0; i < n; i++) sum_get += iv[i];
+    });
+
+    // get single entries at random positions - each position depends on the
+    // previous entry, so that the accesses cannot be overlapped or vectorized
+    uint64_t sum_rand = 0;
+    const uint64_t t_rand = measure([&](){
+        for(const size_t i : queries) sum_rand += iv[i & ~(sum_rand & 1)];
+    });
+
+    // get single entries with a fixed width
+    uint64_t sum_fixed = 0, sum_rand_fixed = 0, sum_get_fixed = 0;
+    uint64_t t_fixed = 0, t_rand_fixed = 0, t_get_fixed = 0;
+    switch(w) {
+        case 1:  measure_fixed<1>(iv, queries, sum_fixed, sum_rand_fixed, sum_get_fixed, t_fixed, t_rand_fixed, t_get_fixed); break;
+        case 7:  measure_fixed<7>(iv, queries, sum_fixed, sum_rand_fixed, sum_get_fixed, t_fixed, t_rand_fixed, t_get_fixed); break;
+        case 8:  measure_fixed<8>(iv, queries, sum_fixed, sum_rand_fixed, sum_get_fixed, t_fixed, t_rand_fixed, t_get_fixed); break;
+        case 12: measure_fixed<12>(iv, queries, sum_fixed, sum_rand_fixed, sum_get_fixed, t_fixed, t_rand_fixed, t_get_fixed); break;
+        case 16: measure_fixed<16>(iv, queries, sum_fixed, sum_rand_fixed, sum_get_fixed, t_fixed, t_rand_fixed, t_get_fixed); break;
+        case 29: measure_fixed<29>(iv, queries, sum_fixed, sum_rand_fixed, sum_get_fixed, t_fixed, t_rand_fixed, t_get_fixed); break;
+        case 32: measure_fixed<32>(iv, queries, sum_fixed, sum_rand_fixed, sum_get_fixed, t_fixed, t_rand_fixed, t_get_fixed); break;
+        case 40: measure_fixed<40>(iv, queries, sum_fixed, sum_rand_fixed, sum_get_fixed, t_fixed, t_rand_fixed, t_get_fixed); break;
+        case 63: measure_fixed<63>(iv, queries, sum_fixed, sum_rand_fixed, sum_get_fixed, t_fixed, t_rand_fixed, t_get_fixed); break;
+        case 64: measure_fixed<64>(iv, queries, sum_fixed, sum_rand_fixed, sum_get_fixed, t_fixed, t_rand_fixed, t_get_fixed); break;
+    }
+
+    // bulk copy
+    int_vector iv2(n, w);
+    const uint64_t t_copy = measure([&](){
+        iv2.copy_from(values.begin(), values.end());
+    });
+
+    // bulk decode
+    uint64_t sum_decode = 0;
+    const uint64_t t_decode = measure([&](){
+        uint64_t buf[BLOCK];
+        for(size_t i = 0; i < n; i += BLOCK) {
+            const size_t k = std::min(n - i, BLOCK);
+            iv2.decode_block(i, k, buf);
+            for(size_t j = 0; j < k; j++) sum_decode += buf[j];
+        }
+    });
+
+    // sequential scan
+    uint64_t sum_scan = 0;
+    const uint64_t t_scan = measure([&](){
+        for(const uint64_t v : iv2.scan()) sum_scan += v;
+    });
+
+    // bulk fill
+    const uint64_t t_fill = measure([&](){
+        iv2.fill(values[0]);
+    });
+    sink = iv2[n - 1];
+
+    std::cout << "RESULT n=" << n
+        << " w=" << w
+        << " kernel=" << bit_unpack::kernel()
+        << " t_set=" << t_set
+        << " t_get=" << t_get
+        << " t_get_fixed=" << t_get_fixed
+        << " t_fixed=" << t_fixed
+        << " t_rand=" << t_rand
+        << " t_rand_fixed=" << t_rand_fixed
+        << " t_copy=" << t_copy
+        << " t_decode=" << t_decode
+        << " t_scan=" << t_scan
+        << " t_fill=" << t_fill
+        << " check=" << (sum_get == sum_fixed && sum_get == sum_get_fixed && sum_rand == sum_rand_fixed && sum_get == sum_decode && sum_get == sum_scan ? "ok" : "FAIL")
+        << std::endl;
+}
+
+int main(int argc, char** argv) {
+    tlx::CmdlineParser cp;
+
+    size_t n = 100'000'000ULL;
+    cp.add_bytes('n', "num", n, "The number of entries (default: 100M).");
+
+    size_t seed = 147ULL;
+    cp.add_size_t('s', "seed", seed, "The seed for random generation (default: 147).");
+
+    if(!cp.process(argc, argv)) {
+        return -1;
+    }
+
+    std::default_random_engine gen(seed);
+    std::uniform_int_distribution<uint64_t> dist;
+
+    std::vector<uint64_t> values(n);
+    for(auto& v : values) v = dist(gen);
+
+    std::uniform_int_distribution<size_t> pos_dist(0, n - 1);
+    std::vector<size_t> queries(n / 16); // random accesses are much slower
+    for(auto& i : queries) i = pos_dist(gen);
+
+    for(const size_t w : { 1, 7, 8, 12, 16, 29, 32, 40, 63, 64 }) {
+        // restrict values to the width so that sums are comparable
+        std::vector<uint64_t> masked(values);
+        for(auto& v : masked) v &= bit_mask(w);
+        bench(n, w, masked, queries);
+    }
+
+    return 0;
+}
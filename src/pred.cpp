@@ -1,43 +1,101 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <cstdlib>
 #include <iostream>
 #include <random>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
 #include <tlx/cmdline_parser.hpp>
 
 #include <stash/pred/binsearch.hpp>
 #include <stash/pred/binsearch_cache.hpp>
+#include <stash/pred/bit_tree.hpp>
+#include <stash/pred/btree.hpp>
+#include <stash/pred/elias_fano.hpp>
+#include <stash/pred/eytzinger.hpp>
+#include <stash/pred/finger.hpp>
 #include <stash/pred/index.hpp>
 #include <stash/pred/index_compact.hpp>
+#include <stash/pred/node_search.hpp>
+#include <stash/pred/pgm.hpp>
 #include <stash/pred/rank.hpp>
 #include <stash/pred/sample.hpp>
+#include <stash/pred/stree.hpp>
 #include <stash/pred/tree3.hpp>
 
 #include <stash/io/load_file.hpp>
+#include <stash/io/mapped_array.hpp>
+#include <stash/io/serialize.hpp>
 #include <stash/util/malloc_callback.hpp>
+#include <stash/util/parallel.hpp>
+#include <stash/util/random.hpp>
 #include <stash/util/time.hpp>
 #include <stash/util/uint40.hpp>
+#include <stash/vec/bit_unpack.hpp>
+#include <stash/vec/popcount.hpp>
+#include <stash/vec/util.hpp>
 
 using namespace stash;
 
 using value_t = uint40_t;
-using binsearch       = pred::binsearch<std::vector<value_t>, value_t>;
-using binsearch_cache = pred::binsearch_cache<std::vector<value_t>, value_t>;
-using rank            = pred::rank<std::vector<value_t>, value_t>;
+using array_t = io::mapped_array<value_t>;
+
+using binsearch       = pred::binsearch<array_t, value_t>;
+using binsearch_cache = pred::binsearch_cache<array_t, value_t>;
+using binsearch_cache_ip = pred::binsearch_cache<array_t, value_t, 512ULL / sizeof(value_t), pred::search::interpolation>;
+using binsearch_cache_is = pred::binsearch_cache<array_t, value_t, 512ULL / sizeof(value_t), pred::search::interpolation_sequential<>>;
+using btree           = pred::btree<value_t, uint64_t>;
+using elias_fano      = pred::elias_fano<array_t, value_t>;
+using eytzinger       = pred::eytzinger<array_t, value_t>;
+using rank            = pred::rank<array_t, value_t>;
+using rank_il         = pred::rank<array_t, value_t, bit_rank_interleaved>;
+using stree           = pred::stree<array_t, value_t>;
+using stree64         = pred::stree<array_t, value_t, uint64_t>;
 
 template<size_t k>
-using sample = pred::sample<std::vector<value_t>, value_t, k>;
+using bit_tree = pred::bit_tree<array_t, value_t, k>;
 
 template<size_t k>
-using index = pred::index<std::vector<value_t>, value_t, k>;
+using btree_leaf = pred::btree<value_t, uint64_t, k>;
 
 template<size_t k>
-using index_compact = pred::index_compact<std::vector<value_t>, value_t, k>;
+using sample = pred::sample<array_t, value_t, k>;
+
+template<size_t k>
+using sample_ip = pred::sample<array_t, value_t, k, 512ULL / sizeof(value_t), pred::search::interpolation>;
+
+template<size_t k>
+using index = pred::index<array_t, value_t, k>;
+
+template<size_t k>
+using index_ip = pred::index<array_t, value_t, k, 512ULL / sizeof(value_t), pred::search::interpolation>;
+
+template<size_t k>
+using index_is = pred::index<array_t, value_t, k, 512ULL / sizeof(value_t), pred::search::interpolation_sequential<>>;
+
+template<size_t k>
+using index_compact = pred::index_compact<array_t, value_t, k>;
+
+template<size_t k>
+using index_compact_ef = pred::index_compact<array_t, value_t, k, 512ULL / sizeof(value_t), civ::elias_fano>;
+
+template<size_t k>
+using index_compact_ip = pred::index_compact<array_t, value_t, k, 512ULL / sizeof(value_t), civ::unary_sorted_sequence, pred::search::interpolation>;
+
+template<size_t eps>
+using pgm = pred::pgm<array_t, value_t, eps>;
 
 template<size_t l1, size_t l2, size_t l3>
-using tree3 = pred::tree3<std::vector<value_t>, value_t, l1, l2, l3>;
+using tree3 = pred::tree3<array_t, value_t, l1, l2, l3>;
+
+// atomic, because constructions may allocate and free from multiple threads
+std::atomic<size_t> mem = 0;
 
-size_t mem = 0;
+// the number of threads to perform queries with
+size_t query_threads = 1;
 
 namespace malloc_callback {
 
@@ -51,40 +109,309 @@ void on_free(size_t num) {
 
 }
 
-std::vector<value_t> generate_queries(size_t num, size_t universe, size_t seed = 147ULL) {
+std::string query_dists[] = { "uniform", "zipf", "sorted", "hits", "clustered" };
+
+// the number of clusters for clustered queries, and their standard
+// deviation in multiples of the average distance between keys
+constexpr size_t QUERY_CLUSTERS = 64;
+constexpr double QUERY_CLUSTER_SPREAD = 256.0;
+
+// generates queries following the given distribution (see query_dists):
+// - uniform:   uniformly random values in [0, universe]
+// - zipf:      existing keys, whose popularity follows Zipf's law with exponent
+//              zipf_s - the popular keys are scattered over the array
+// - sorted:    like uniform, but in ascending order
+// - hits:      uniformly random existing keys
+// - clustered: normally distributed values around a few random keys
+std::vector<value_t> generate_queries(
+    const array_t& array, size_t num, size_t universe,
+    const std::string& dist_name, double zipf_s, size_t seed = 147ULL) {
+
     std::vector<value_t> queries;
     queries.reserve(num);
 
     // seed
     std::default_random_engine gen(seed);
-    std::uniform_int_distribution<uint64_t> dist(0, universe);
 
     // generate
-    for(size_t i = 0; i < num; i++) {
-        queries.push_back(value_t(dist(gen)));
+    const size_t n = array.size();
+    if(dist_name == "zipf") {
+        random::zipf zipf(n, zipf_s);
+        random::permutation perm(n, seed);
+        for(size_t i = 0; i < num; i++) {
+            queries.push_back(array[perm(zipf(gen))]);
+        }
+    } else if(dist_name == "hits") {
+        std::uniform_int_distribution<size_t> dist(0, n - 1);
+        for(size_t i = 0; i < num; i++) {
+            queries.push_back(array[dist(gen)]);
+        }
+    } else if(dist_name == "clustered") {
+        std::uniform_int_distribution<size_t> pick(0, n - 1);
+        std::vector<double> centers(QUERY_CLUSTERS);
+        for(auto& c : centers) c = double(uint64_t(array[pick(gen)]));
+
+        std::uniform_int_distribution<size_t> cluster(0, QUERY_CLUSTERS - 1);
+        std::normal_distribution<double> offset(0.0, QUERY_CLUSTER_SPREAD * double(universe) / double(n));
+        for(size_t i = 0; i < num; i++) {
+            const double x = std::round(centers[cluster(gen)] + offset(gen));
+            queries.push_back(value_t(uint64_t(std::clamp(x, 0.0, double(universe)))));
+        }
+    } else {
+        // uniform or sorted
+        std::uniform_int_distribution<uint64_t> dist(0, universe);
+        for(size_t i = 0; i < num; i++) {
+            queries.push_back(value_t(dist(gen)));
+        }
+
+        if(dist_name == "sorted") {
+            std::sort(queries.begin(), queries.end());
+        }
     }
 
     return queries;
 }
 
-std::string test_types[] = { "predecessor", "successor" };
+std::string test_types[] = { "predecessor", "successor", "construct", "persist", "mixed" };
 
 struct test_result {
-    uint8_t  type;
-    uint64_t t_construct;
-    size_t   m_ds;
-    uint64_t t_queries;
-    uint64_t sum;
+    uint8_t  type = 0;
+    uint64_t t_construct = 0;
+    size_t   m_ds = 0;
+    uint64_t t_queries = 0;
+    uint64_t sum = 0;
+    bool     batch = false;
+    uint64_t t_batch = 0;
+    bool     persist = false;
+    uint64_t t_save = 0;
+    uint64_t t_map = 0;
+    std::vector<uint64_t> t_threads = {}; // query time of each thread, if multiple
+    bool     batch_ok = true; // whether the batched queries agree with the single ones
 };
 
+// calls f(begin, end) for the queries in [0, n), which returns the sum of
+// the results, using query_threads threads pinned to cores that each handle
+// a consecutive slice - the structures are read-only, so no locking is needed
+//
+// returns the total sum and writes the times to t and t_threads
+template<typename func_t>
+uint64_t run_queries(const size_t n, func_t f, uint64_t& t, std::vector<uint64_t>& t_threads) {
+    if(query_threads <= 1) {
+        const auto t0 = time();
+        const uint64_t sum = f(size_t(0), n);
+        t = time() - t0;
+        return sum;
+    }
+
+    std::vector<uint64_t> sums(query_threads);
+    t_threads.assign(query_threads, 0);
+
+    const auto t0 = time();
+    parallel_for_pinned(n, query_threads, [&](const size_t i, const size_t begin, const size_t end){
+        const auto t0 = time();
+        sums[i] = f(begin, end);
+        t_threads[i] = time() - t0;
+    });
+    t = time() - t0;
+
+    uint64_t sum = 0;
+    for(const uint64_t s : sums) sum += s;
+    return sum;
+}
+
+// tests whether a predecessor data structure supports batched queries
+template<typename pred_t, typename = void>
+struct has_batch : std::false_type {};
+
+template<typename pred_t>
+struct has_batch<pred_t, std::void_t<decltype(
+    std::declval<const pred_t&>().predecessor_batch(nullptr, 0, nullptr))>> : std::true_type {};
+
+// measures the construction time using the given number of threads
+template<typename pred_t>
+test_result test_construct(
+    const array_t& array,
+    const size_t num_threads) {
+
+    auto t0 = time();
+    size_t m0 = mem;
+    pred_t q(array, num_threads);
+    uint64_t t_construct = time() - t0;
+    size_t   m_ds = mem - m0;
+
+    return test_result { 2, t_construct, m_ds, 0, 0, false, 0 };
+}
+
+// gets the value reported by a query result - unless the data structure
+// reports it itself, it is looked up in the input sequence
+template<typename result_t>
+inline value_t result_value(const array_t& array, const result_t& r) {
+    if constexpr(std::is_same<result_t, pred::result>::value) {
+        return array[r.pos];
+    } else {
+        assert(r.value == array[r.pos]);
+        return r.value;
+    }
+}
+
+// checks that the positions reported by a data structure index the input
+// array if keys occur multiple times - the runs of duplicates are longer than
+// the nodes of the data structures, so that they span multiple nodes
+template<typename pred_t>
+bool check_duplicates() {
+    constexpr uint64_t num_keys = 256;
+    constexpr uint64_t gap = 16;
+
+    std::vector<value_t> v;
+    for(uint64_t k = 1; k <= num_keys; k++) {
+        const size_t run = (k * 37) % 150 + 1;
+        for(size_t j = 0; j < run; j++) v.push_back(value_t(k * gap));
+    }
+    const array_t array(std::move(v));
+
+    // the value reported by a query must be the one at its position
+    auto consistent = [&](const auto& r){
+        if constexpr(std::is_same<std::decay_t<decltype(r)>, pred::result>::value) {
+            return true;
+        } else {
+            return r.value == array[r.pos];
+        }
+    };
+
+    pred_t q(array);
+    bool ok = true;
+    for(uint64_t x = 0; x <= (num_keys + 1) * gap; x++) {
+        const uint64_t pred = std::min(x / gap, num_keys) * gap;
+        const auto p = q.predecessor(value_t(x));
+        if(pred) {
+            ok = ok && p.exists && p.pos < array.size() && array[p.pos] == value_t(pred) && consistent(p);
+        } else {
+            ok = ok && !p.exists;
+        }
+
+        const uint64_t succ = std::max(idiv_ceil(x, gap), uint64_t(1)) * gap;
+        const auto s = q.successor(value_t(x));
+        if(succ <= num_keys * gap) {
+            ok = ok && s.exists && s.pos < array.size() && array[s.pos] == value_t(succ) && consistent(s);
+        } else {
+            ok = ok && !s.exists;
+        }
+    }
+    return ok;
+}
+
+// measures the times needed to write a data structure to the given file
+// and to map it back into memory, and then performs predecessor queries
+template<typename pred_t>
+test_result test_persist(
+    const array_t& array,
+    const std::vector<value_t>& queries,
+    const std::string& filename) {
+
+    // construct and write
+    uint64_t t_construct, t_save;
+    {
+        auto t0 = time();
+        pred_t q(array);
+        t_construct = time() - t0;
+
+        t0 = time();
+        io::serializer out(filename);
+        q.write(out);
+        t_save = time() - t0;
+    }
+
+    // map
+    auto t0 = time();
+    size_t m0 = mem;
+    io::mapped_reader in(filename);
+    pred_t q(array, in);
+    uint64_t t_map = time() - t0;
+    size_t   m_ds = mem - m0;
+
+    if(!in) {
+        std::cerr << "failed to map " << filename << std::endl;
+        std::abort();
+    }
+
+    // do queries
+    const auto min = array[0];
+    uint64_t sum = 0;
+    t0 = time();
+    for(value_t x : queries) {
+        auto r = q.predecessor(x);
+        if(x >= min) sum += result_value(array, r);
+    }
+    uint64_t t_queries = time() - t0;
+
+    return test_result { 3, t_construct, m_ds, t_queries, sum, false, 0, true, t_save, t_map };
+}
+
+// measures the throughput of a dynamic data structure under a mix of
+// predecessor queries and updates, where each operation is an update with
+// the given probability - updates alternate between inserting the query value
+// and erasing a random item of the input, so the size stays roughly the same
 template<typename pred_t>
+test_result test_mixed(
+    const array_t& array,
+    const std::vector<value_t>& queries,
+    const double update_ratio) {
+
+    // construct
+    auto t0 = time();
+    size_t m0 = mem;
+    pred_t q(array);
+    uint64_t t_construct = time() - t0;
+
+    // decide on the operations beforehand
+    enum op_t : uint8_t { QUERY, INSERT, ERASE };
+    std::vector<std::pair<op_t, value_t>> ops;
+    ops.reserve(queries.size());
+    {
+        std::default_random_engine gen(147ULL);
+        std::bernoulli_distribution update(update_ratio);
+        std::uniform_int_distribution<size_t> item(0, array.size() - 1);
+
+        bool insert = true;
+        for(value_t x : queries) {
+            if(update(gen)) {
+                ops.emplace_back(insert ? INSERT : ERASE, insert ? x : array[item(gen)]);
+                insert = !insert;
+            } else {
+                ops.emplace_back(QUERY, x);
+            }
+        }
+    }
+
+    // do operations - the sum includes the number of successful updates
+    uint64_t sum = 0;
+    t0 = time();
+    for(const auto& op : ops) {
+        switch(op.first) {
+            case QUERY: {
+                auto r = q.predecessor(op.second);
+                if(r.exists) sum += r.value;
+                break;
+            }
+            case INSERT: sum += q.insert(op.second); break;
+            case ERASE:  sum += q.erase(op.second); break;
+        }
+    }
+    uint64_t t_queries = time() - t0;
+    size_t   m_ds = mem - m0;
+
+    return test_result { 4, t_construct, m_ds, t_queries, sum, false, 0 };
+}
+
+// if m_finger is set, each thread queries through a pred::finger
+template<typename pred_t, bool m_finger = false>
 test_result test_predecessor(
-    const std::vector<value_t>& array,
+    const array_t& array,
     const std::vector<value_t>& queries) {
 
     // construct
     auto t0 = time();
-    auto m0 = mem;
+    size_t m0 = mem;
     pred_t q(array);
     uint64_t t_construct = time() - t0;
     size_t   m_ds = mem - m0;
@@ -92,34 +419,65 @@ test_result test_predecessor(
     // do queries
     const auto min = array[0];
     uint64_t t_queries;
-    uint64_t sum = 0;
-    {
-        auto t0 = time();
-        for(value_t x : queries) {
-            auto r = q.predecessor(x);
-
-            if(x >= min) {
-                assert(r.exists);
-                assert(x >= array[r.pos]);
-                sum += array[r.pos];
-            } else {
-                assert(!r.exists);
+    std::vector<uint64_t> t_threads;
+    const uint64_t sum = run_queries(queries.size(), [&](const size_t begin, const size_t end){
+        auto scan = [&](auto&& s){
+            uint64_t sum = 0;
+            for(size_t i = begin; i < end; i++) {
+                const value_t x = queries[i];
+                auto r = s.predecessor(x);
+
+                if(x >= min) {
+                    assert(r.exists);
+                    assert(x >= array[r.pos]);
+                    sum += result_value(array, r);
+                } else {
+                    assert(!r.exists);
+                }
             }
+            return sum;
+        };
+
+        if constexpr(m_finger) {
+            return scan(pred::finger<pred_t, array_t, value_t>(q, array));
+        } else {
+            return scan(q);
         }
-        t_queries = time() - t0;
+    }, t_queries, t_threads);
+
+    // do batched queries
+    constexpr bool batch = has_batch<pred_t>::value && !m_finger;
+    uint64_t t_batch = 0;
+    bool batch_ok = true;
+    if constexpr(batch) {
+        std::vector<pred::result> results(queries.size());
+        std::vector<uint64_t> t_batch_threads;
+
+        const uint64_t sum_batch = run_queries(queries.size(), [&](const size_t begin, const size_t end){
+            q.predecessor_batch(queries.data() + begin, end - begin, results.data() + begin);
+
+            uint64_t sum = 0;
+            for(size_t i = begin; i < end; i++) {
+                if(results[i].exists) sum += array[results[i].pos];
+            }
+            return sum;
+        }, t_batch, t_batch_threads);
+
+        batch_ok = (sum_batch == sum);
     }
 
-    return test_result { 0, t_construct, m_ds, t_queries, sum };
+    return test_result { 0, t_construct, m_ds, t_queries, sum, batch, t_batch, false, 0, 0, std::move(t_threads), batch_ok };
 }
 
-template<typename pred_t>
+// if m_finger is set, each thread queries through a pred::finger
+template<typename pred_t, bool m_finger = false>
 test_result test_successor(
-    const std::vector<value_t>& array,
+    const array_t& array,
     const std::vector<value_t>& queries) {
 
     // construct
     auto t0 = time();
-    auto m0 = mem;
+    size_t m0 = mem;
     pred_t q(array);
     uint64_t t_construct = time() - t0;
     size_t   m_ds = mem - m0;
@@ -127,23 +485,54 @@ test_result test_successor(
     // do queries
     const auto max = array[array.size()-1ULL];
     uint64_t t_queries;
-    uint64_t sum = 0;
-    {
-        auto t0 = time();
-        for(value_t x : queries) {
-            auto r = q.successor(x);
-            if(x <= max) {
-                assert(r.exists);
-                assert(x <= array[r.pos]);
-                sum += array[r.pos];
-            } else {
-                assert(!r.exists);
+    std::vector<uint64_t> t_threads;
+    const uint64_t sum = run_queries(queries.size(), [&](const size_t begin, const size_t end){
+        auto scan = [&](auto&& s){
+            uint64_t sum = 0;
+            for(size_t i = begin; i < end; i++) {
+                const value_t x = queries[i];
+                auto r = s.successor(x);
+
+                if(x <= max) {
+                    assert(r.exists);
+                    assert(x <= array[r.pos]);
+                    sum += result_value(array, r);
+                } else {
+                    assert(!r.exists);
+                }
             }
+            return sum;
+        };
+
+        if constexpr(m_finger) {
+            return scan(pred::finger<pred_t, array_t, value_t>(q, array));
+        } else {
+            return scan(q);
         }
-        t_queries = time() - t0;
+    }, t_queries, t_threads);
+
+    // do batched queries
+    constexpr bool batch = has_batch<pred_t>::value && !m_finger;
+    uint64_t t_batch = 0;
+    bool batch_ok = true;
+    if constexpr(batch) {
+        std::vector<pred::result> results(queries.size());
+        std::vector<uint64_t> t_batch_threads;
+
+        const uint64_t sum_batch = run_queries(queries.size(), [&](const size_t begin, const size_t end){
+            q.successor_batch(queries.data() + begin, end - begin, results.data() + begin);
+
+            uint64_t sum = 0;
+            for(size_t i = begin; i < end; i++) {
+                if(results[i].exists) sum += array[results[i].pos];
+            }
+            return sum;
+        }, t_batch, t_batch_threads);
+
+        batch_ok = (sum_batch == sum);
     }
 
-    return test_result { 1, t_construct, m_ds, t_queries, sum };
+    return test_result { 1, t_construct, m_ds, t_queries, sum, batch, t_batch, false, 0, 0, std::move(t_threads), batch_ok };
 }
 
 int main(int argc, char** argv) {
@@ -158,6 +547,12 @@ int main(int argc, char** argv) {
     size_t universe = 0;
     cp.add_bytes('u', "universe", universe, "The universe to draw query numbers from. Default is maximum value + 1.");
 
+    std::string query_dist = "uniform";
+    cp.add_string('d', "dist", query_dist, "The distribution of the queries: uniform, zipf, sorted, hits (existing keys only) or clustered. Default is uniform.");
+
+    double zipf_s = 1.0;
+    cp.add_double('z', "zipf", zipf_s, "The exponent for Zipf-distributed queries. Default is 1.");
+
     bool add_max = false;
     cp.add_flag('m', "max", add_max, "Append the maximum possible value to the input sequence.");
 
@@ -170,56 +565,162 @@ int main(int argc, char** argv) {
     bool no_succ = false;
     cp.add_bool("no-succ", no_succ, "Don't do successor benchmark.");
 
+    std::string persist_prefix;
+    cp.add_string('p', "persist", persist_prefix, "Write some of the data structures to files starting with this prefix and measure how long it takes to map them back into memory. Default is none.");
+
+    double update_ratio = 0;
+    cp.add_double('r', "updates", update_ratio, "Measure the throughput of the dynamic data structures under a mix of queries and updates, where this is the ratio of updates (between 0 and 1). Default is none.");
+
+    cp.add_size_t('t', "threads", query_threads, "The number of threads to perform the predecessor and successor queries with, each pinned to a core and handling a slice of the queries. Default is 1.");
+
+    size_t max_threads = 0;
+    cp.add_size_t('c', "construct-threads", max_threads, "Measure construction times of the indexes using 1 up to this many threads (doubling). Default is none.");
+
     if (!cp.process(argc, argv)) {
         return -1;
     }
 
+    if(std::find(std::begin(query_dists), std::end(query_dists), query_dist) == std::end(query_dists)) {
+        std::cerr << "unknown query distribution: " << query_dist << std::endl;
+        return -1;
+    }
+
     // load input
     std::cout << "# loading input ..." << std::endl;
 
-    std::vector<value_t> array;
-    if(lines) {
-        array = io::load_file_lines_as_vector<value_t>(input_filename);
-    } else {
-        array = io::load_file_as_vector<uint40_t, value_t>(input_filename);
-    }
+    array_t array;
+    if(lines || add_max) {
+        std::vector<value_t> v;
+        if(lines) {
+            v = io::load_file_lines_as_vector<value_t>(input_filename);
+        } else {
+            v = io::load_file_as_vector<uint40_t, value_t>(input_filename);
+        }
 
-    if(!universe) {
-        universe = (size_t)array[array.size() - 1] + 1;
-    }
+        if(v.empty()) {
+            std::cerr << "failed to load input file or input is empty: " << input_filename << std::endl;
+            return -1;
+        }
+
+        if(!universe) {
+            universe = (size_t)v[v.size() - 1] + 1;
+        }
 
-    if(add_max) {
-        array.push_back(value_t(UINT64_MAX));
+        if(add_max) {
+            v.push_back(value_t(UINT64_MAX));
+        }
+
+        array = array_t(std::move(v));
+    } else {
+        // map the input file directly
+        array = array_t(input_filename);
+        if(array.size() == 0) {
+            std::cerr << "failed to map input file or input is empty: " << input_filename << std::endl;
+            return -1;
+        }
+
+        if(!universe) {
+            universe = (size_t)array[array.size() - 1] + 1;
+        }
     }
 
     // generate queries
     std::cout << "# generating queries ..." << std::endl;
-    auto queries = generate_queries(num_queries, universe);
+    auto queries = generate_queries(array, num_queries, universe, query_dist, zipf_s);
 
     // lambda to print a test result
-    auto print_result = [&](const std::string& name, test_result&& r){
+    auto print_result = [&](const std::string& name, test_result&& r, const size_t threads = 1){
         std::cout << "RESULT algo="<< name
+            << " threads=" << (r.t_threads.empty() ? threads : r.t_threads.size())
             << " queries=" << queries.size()
+            << " dist=" << query_dist;
+
+        if(query_dist == "zipf") {
+            std::cout << " zipf=" << zipf_s;
+        }
+
+        std::cout
             << " type=" << test_types[r.type]
             << " universe=" << universe
             << " keys=" << array.size()
+            << " kernel.popcount=" << popcount_kernel()
+            << " kernel.select=" << select_kernel()
+            << " kernel.unpack=" << bit_unpack::kernel()
+            << " kernel.search=" << pred::node_search<uint64_t>::kernel()
             << " t_construct=" << r.t_construct
-            << " t_queries=" << r.t_queries
+            << " t_queries=" << r.t_queries;
+
+        if(r.batch) {
+            std::cout << " t_batch=" << r.t_batch
+                << " check=" << (r.batch_ok ? "ok" : "FAIL");
+        }
+
+        if(r.persist) {
+            std::cout << " t_save=" << r.t_save << " t_map=" << r.t_map;
+        }
+
+        if(r.type == 4) {
+            std::cout << " updates=" << update_ratio;
+        }
+
+        if(r.type != 2) {
+            // aggregate throughput in queries per second
+            std::cout << " throughput=" << (queries.size() * 1000ULL / std::max(r.t_queries, uint64_t(1)));
+        }
+
+        if(!r.t_threads.empty()) {
+            std::cout << " t_threads=";
+            for(size_t i = 0; i < r.t_threads.size(); i++) {
+                std::cout << (i ? "," : "") << r.t_threads[i];
+            }
+        }
+
+        std::cout
             << " m_ds=" << r.m_ds
             << " sum=" << r.sum << std::endl;
     };
 
+    // lambda to print the result of check_duplicates
+    auto print_check = [&](const std::string& name, const bool ok){
+        std::cout << "RESULT algo=" << name
+            << " type=duplicates"
+            << " check=" << (ok ? "ok" : "FAIL") << std::endl;
+    };
+
     // run tests
+    std::cout << "# duplicates ..." << std::endl;
+    print_check("bs", check_duplicates<binsearch>());
+    print_check("bs*", check_duplicates<binsearch_cache>());
+    print_check("ef", check_duplicates<elias_fano>());
+    print_check("idx<8>", check_duplicates<index<8>>());
+    print_check("btree", check_duplicates<btree>());
+    print_check("btree<32>", check_duplicates<btree_leaf<32>>());
+
     if(!no_pred) {
     std::cout << "# predecessor ..." << std::endl;
     print_result("bs", test_predecessor<binsearch>(array, queries));
     print_result("bs*", test_predecessor<binsearch_cache>(array, queries));
+    print_result("bs*-ip", test_predecessor<binsearch_cache_ip>(array, queries));
+    print_result("bs*-is", test_predecessor<binsearch_cache_is>(array, queries));
+    print_result("eytz", test_predecessor<eytzinger>(array, queries));
+    print_result("stree", test_predecessor<stree>(array, queries));
+    print_result("stree64", test_predecessor<stree64>(array, queries));
+    print_result("btree", test_predecessor<btree>(array, queries));
+    print_result("ef", test_predecessor<elias_fano>(array, queries));
     print_result("rank", test_predecessor<rank>(array, queries));
+    print_result("rank-il", test_predecessor<rank_il>(array, queries));
+    print_result("bt<0>", test_predecessor<bit_tree<0>>(array, queries));
+    print_result("bt<4>", test_predecessor<bit_tree<4>>(array, queries));
+    print_result("bt<8>", test_predecessor<bit_tree<8>>(array, queries));
+    print_result("bt<12>", test_predecessor<bit_tree<12>>(array, queries));
+    print_result("bt<16>", test_predecessor<bit_tree<16>>(array, queries));
     print_result("sample<64>", test_predecessor<sample<64>>(array, queries));
     print_result("sample<128>", test_predecessor<sample<128>>(array, queries));
     print_result("sample<256>", test_predecessor<sample<256>>(array, queries));
     print_result("sample<512>", test_predecessor<sample<512>>(array, queries));
     print_result("sample<1024>", test_predecessor<sample<1024>>(array, queries));
+    print_result("sample<256>-ip", test_predecessor<sample_ip<256>>(array, queries));
+    print_result("sample<1024>-ip", test_predecessor<sample_ip<1024>>(array, queries));
     print_result("idx<4>", test_predecessor<index<4>>(array, queries));
     print_result("idx<5>", test_predecessor<index<5>>(array, queries));
     print_result("idx<6>", test_predecessor<index<6>>(array, queries));
@@ -229,6 +730,17 @@ int main(int argc, char** argv) {
     print_result("idx<10>", test_predecessor<index<10>>(array, queries));
     print_result("idx<11>", test_predecessor<index<11>>(array, queries));
     print_result("idx<12>", test_predecessor<index<12>>(array, queries));
+    print_result("idx<8>-ip", test_predecessor<index_ip<8>>(array, queries));
+    print_result("idx<10>-ip", test_predecessor<index_ip<10>>(array, queries));
+    print_result("idx<12>-ip", test_predecessor<index_ip<12>>(array, queries));
+    print_result("idx<8>-is", test_predecessor<index_is<8>>(array, queries));
+    print_result("idx<10>-is", test_predecessor<index_is<10>>(array, queries));
+    print_result("idx<12>-is", test_predecessor<index_is<12>>(array, queries));
+    print_result("pgm<16>", test_predecessor<pgm<16>>(array, queries));
+    print_result("pgm<32>", test_predecessor<pgm<32>>(array, queries));
+    print_result("pgm<64>", test_predecessor<pgm<64>>(array, queries));
+    print_result("pgm<128>", test_predecessor<pgm<128>>(array, queries));
+    print_result("pgm<256>", test_predecessor<pgm<256>>(array, queries));
     print_result("cidx<4>", test_predecessor<index_compact<4>>(array, queries));
     print_result("cidx<5>", test_predecessor<index_compact<5>>(array, queries));
     print_result("cidx<6>", test_predecessor<index_compact<6>>(array, queries));
@@ -238,18 +750,51 @@ int main(int argc, char** argv) {
     print_result("cidx<10>", test_predecessor<index_compact<10>>(array, queries));
     print_result("cidx<11>", test_predecessor<index_compact<11>>(array, queries));
     print_result("cidx<12>", test_predecessor<index_compact<12>>(array, queries));
+    print_result("cidx<8>-ip", test_predecessor<index_compact_ip<8>>(array, queries));
+    print_result("cidx<12>-ip", test_predecessor<index_compact_ip<12>>(array, queries));
+    print_result("cidx-ef<4>", test_predecessor<index_compact_ef<4>>(array, queries));
+    print_result("cidx-ef<5>", test_predecessor<index_compact_ef<5>>(array, queries));
+    print_result("cidx-ef<6>", test_predecessor<index_compact_ef<6>>(array, queries));
+    print_result("cidx-ef<7>", test_predecessor<index_compact_ef<7>>(array, queries));
+    print_result("cidx-ef<8>", test_predecessor<index_compact_ef<8>>(array, queries));
+    print_result("cidx-ef<9>", test_predecessor<index_compact_ef<9>>(array, queries));
+    print_result("cidx-ef<10>", test_predecessor<index_compact_ef<10>>(array, queries));
+    print_result("cidx-ef<11>", test_predecessor<index_compact_ef<11>>(array, queries));
+    print_result("cidx-ef<12>", test_predecessor<index_compact_ef<12>>(array, queries));
+    print_result("tree3<8,16,16>", test_predecessor<tree3<8, 16, 16>>(array, queries));
+    print_result("tree3<12,16,12>", test_predecessor<tree3<12, 16, 12>>(array, queries));
+    print_result("tree3<16,16,8>", test_predecessor<tree3<16, 16, 8>>(array, queries));
+    print_result("bs*-finger", test_predecessor<binsearch_cache, true>(array, queries));
+    print_result("ef-finger", test_predecessor<elias_fano, true>(array, queries));
+    print_result("bt<8>-finger", test_predecessor<bit_tree<8>, true>(array, queries));
+    print_result("idx<8>-finger", test_predecessor<index<8>, true>(array, queries));
     }
 
     if(!no_succ) {
     std::cout << "# successor ..." << std::endl;
     print_result("bs", test_successor<binsearch>(array, queries));
     print_result("bs*", test_successor<binsearch_cache>(array, queries));
+    print_result("bs*-ip", test_successor<binsearch_cache_ip>(array, queries));
+    print_result("bs*-is", test_successor<binsearch_cache_is>(array, queries));
+    print_result("eytz", test_successor<eytzinger>(array, queries));
+    print_result("stree", test_successor<stree>(array, queries));
+    print_result("stree64", test_successor<stree64>(array, queries));
+    print_result("btree", test_successor<btree>(array, queries));
+    print_result("ef", test_successor<elias_fano>(array, queries));
     print_result("rank", test_successor<rank>(array, queries));
+    print_result("rank-il", test_successor<rank_il>(array, queries));
+    print_result("bt<0>", test_successor<bit_tree<0>>(array, queries));
+    print_result("bt<4>", test_successor<bit_tree<4>>(array, queries));
+    print_result("bt<8>", test_successor<bit_tree<8>>(array, queries));
+    print_result("bt<12>", test_successor<bit_tree<12>>(array, queries));
+    print_result("bt<16>", test_successor<bit_tree<16>>(array, queries));
     print_result("sample<64>", test_successor<sample<64>>(array, queries));
     print_result("sample<128>", test_successor<sample<128>>(array, queries));
     print_result("sample<256>", test_successor<sample<256>>(array, queries));
     print_result("sample<512>", test_successor<sample<512>>(array, queries));
     print_result("sample<1024>", test_successor<sample<1024>>(array, queries));
+    print_result("sample<256>-ip", test_successor<sample_ip<256>>(array, queries));
+    print_result("sample<1024>-ip", test_successor<sample_ip<1024>>(array, queries));
     print_result("idx<4>", test_successor<index<4>>(array, queries));
     print_result("idx<5>", test_successor<index<5>>(array, queries));
     print_result("idx<6>", test_successor<index<6>>(array, queries));
@@ -259,6 +804,17 @@ int main(int argc, char** argv) {
     print_result("idx<10>", test_successor<index<10>>(array, queries));
     print_result("idx<11>", test_successor<index<11>>(array, queries));
     print_result("idx<12>", test_successor<index<12>>(array, queries));
+    print_result("idx<8>-ip", test_successor<index_ip<8>>(array, queries));
+    print_result("idx<10>-ip", test_successor<index_ip<10>>(array, queries));
+    print_result("idx<12>-ip", test_successor<index_ip<12>>(array, queries));
+    print_result("idx<8>-is", test_successor<index_is<8>>(array, queries));
+    print_result("idx<10>-is", test_successor<index_is<10>>(array, queries));
+    print_result("idx<12>-is", test_successor<index_is<12>>(array, queries));
+    print_result("pgm<16>", test_successor<pgm<16>>(array, queries));
+    print_result("pgm<32>", test_successor<pgm<32>>(array, queries));
+    print_result("pgm<64>", test_successor<pgm<64>>(array, queries));
+    print_result("pgm<128>", test_successor<pgm<128>>(array, queries));
+    print_result("pgm<256>", test_successor<pgm<256>>(array, queries));
     print_result("cidx<4>", test_successor<index_compact<4>>(array, queries));
     print_result("cidx<5>", test_successor<index_compact<5>>(array, queries));
     print_result("cidx<6>", test_successor<index_compact<6>>(array, queries));
@@ -268,5 +824,56 @@ int main(int argc, char** argv) {
     print_result("cidx<10>", test_successor<index_compact<10>>(array, queries));
     print_result("cidx<11>", test_successor<index_compact<11>>(array, queries));
     print_result("cidx<12>", test_successor<index_compact<12>>(array, queries));
+    print_result("cidx<8>-ip", test_successor<index_compact_ip<8>>(array, queries));
+    print_result("cidx<12>-ip", test_successor<index_compact_ip<12>>(array, queries));
+    print_result("cidx-ef<4>", test_successor<index_compact_ef<4>>(array, queries));
+    print_result("cidx-ef<5>", test_successor<index_compact_ef<5>>(array, queries));
+    print_result("cidx-ef<6>", test_successor<index_compact_ef<6>>(array, queries));
+    print_result("cidx-ef<7>", test_successor<index_compact_ef<7>>(array, queries));
+    print_result("cidx-ef<8>", test_successor<index_compact_ef<8>>(array, queries));
+    print_result("cidx-ef<9>", test_successor<index_compact_ef<9>>(array, queries));
+    print_result("cidx-ef<10>", test_successor<index_compact_ef<10>>(array, queries));
+    print_result("cidx-ef<11>", test_successor<index_compact_ef<11>>(array, queries));
+    print_result("cidx-ef<12>", test_successor<index_compact_ef<12>>(array, queries));
+    print_result("tree3<8,16,16>", test_successor<tree3<8, 16, 16>>(array, queries));
+    print_result("tree3<12,16,12>", test_successor<tree3<12, 16, 12>>(array, queries));
+    print_result("tree3<16,16,8>", test_successor<tree3<16, 16, 8>>(array, queries));
+    print_result("bs*-finger", test_successor<binsearch_cache, true>(array, queries));
+    print_result("ef-finger", test_successor<elias_fano, true>(array, queries));
+    print_result("bt<8>-finger", test_successor<bit_tree<8>, true>(array, queries));
+    print_result("idx<8>-finger", test_successor<index<8>, true>(array, queries));
+    }
+
+    if(update_ratio > 0) {
+    std::cout << "# mixed queries and updates ..." << std::endl;
+    print_result("btree<32>", test_mixed<btree_leaf<32>>(array, queries, update_ratio));
+    print_result("btree<64>", test_mixed<btree_leaf<64>>(array, queries, update_ratio));
+    print_result("btree<128>", test_mixed<btree_leaf<128>>(array, queries, update_ratio));
+    }
+
+    if(max_threads) {
+    std::cout << "# construction ..." << std::endl;
+    for(size_t t = 1;; t = std::min(2 * t, max_threads)) {
+        print_result("idx<4>", test_construct<index<4>>(array, t), t);
+        print_result("idx<8>", test_construct<index<8>>(array, t), t);
+        print_result("idx<12>", test_construct<index<12>>(array, t), t);
+        print_result("cidx<4>", test_construct<index_compact<4>>(array, t), t);
+        print_result("cidx<8>", test_construct<index_compact<8>>(array, t), t);
+        print_result("cidx<12>", test_construct<index_compact<12>>(array, t), t);
+        print_result("cidx-ef<4>", test_construct<index_compact_ef<4>>(array, t), t);
+        print_result("cidx-ef<8>", test_construct<index_compact_ef<8>>(array, t), t);
+        print_result("cidx-ef<12>", test_construct<index_compact_ef<12>>(array, t), t);
+        if(t == max_threads) break;
+    }
+    }
+
+    if(!persist_prefix.empty()) {
+    std::cout << "# persistence ..." << std::endl;
+    print_result("idx<8>", test_persist<index<8>>(array, queries, persist_prefix + "idx8"));
+    print_result("cidx<8>", test_persist<index_compact<8>>(array, queries, persist_prefix + "cidx8"));
+    print_result("cidx-ef<8>", test_persist<index_compact_ef<8>>(array, queries, persist_prefix + "cidx-ef8"));
+    print_result("rank", test_persist<rank>(array, queries, persist_prefix + "rank"));
+    print_result("rank-il", test_persist<rank_il>(array, queries, persist_prefix + "rank-il"));
+    print_result("ef", test_persist<elias_fano>(array, queries, persist_prefix + "ef"));
     }
 }
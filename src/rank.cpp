@@ -5,8 +5,11 @@
 #include <stash/rapl/reader.hpp>
 #include <stash/rapl/power.hpp>
 #include <stash/util/rank8_lut.hpp>
+#include <stash/util/cpu.hpp>
 #include <stash/util/rank16_lut.hpp>
 #include <stash/util/time.hpp>
+#include <stash/vec/bit_vector.hpp>
+#include <stash/vec/popcount.hpp>
 
 #include <emmintrin.h>
 
@@ -212,6 +215,17 @@ inline uint64_t rank_popcnt_movdq4(const std::vector<uint64_t>& a) {
     return rank;
 }
 
+// library entry points, which must agree with the methods above
+inline uint64_t rank_library(const std::vector<uint64_t>& a) {
+    return popcount(a.data(), a.size());
+}
+
+inline uint64_t rank_library_blocks(const std::vector<uint64_t>& a) {
+    uint64_t rank = 0;
+    popcount_blocks(a.data(), a.size(), 8, [&](size_t, size_t r){ rank += r; });
+    return rank;
+}
+
 std::vector<uint64_t> generate_queries(size_t num, uint64_t universe, size_t seed = 147ULL) {
     std::vector<uint64_t> queries;
     queries.reserve(num);
@@ -228,11 +242,13 @@ std::vector<uint64_t> generate_queries(size_t num, uint64_t universe, size_t see
     return queries;
 }
 
+// runs the benchmark and reports whether the result equals the expected sum
 template<typename rank_function_t>
-void bench(
+bool bench(
     const std::string& name,
     const rapl::reader& r,
     const std::vector<uint64_t>& queries,
+    const uint64_t expected,
     rank_function_t rank) {
 
     const size_t num = queries.size() - 8;
@@ -253,7 +269,9 @@ void bench(
               << " e.dram=" << e.dram
               << " e.psys=" << e.psys
               << " sum=" << sum
+              << " check=" << (sum == expected ? "ok" : "FAIL")
               << std::endl;
+    return sum == expected;
 }
 
 int main(int argc, char** argv) {
@@ -284,18 +302,64 @@ int main(int argc, char** argv) {
     }
     std::cout << "# Running benchmark (sum=" << sum << ")..." << std::endl;
 
-    bench("shift", r, queries, rank_shift);
-    bench("anderson14", r, queries, rank_anderson14);
-    bench("anderson24", r, queries, rank_anderson24);
-    bench("lut8", r, queries, rank_lut8);
-    bench("lut16", r, queries, rank_lut16);
-    bench("popcnt", r, queries, rank_popcnt);
-    bench("popcnt2", r, queries, rank_popcnt2);
-    bench("popcnt4", r, queries, rank_popcnt4);
-    bench("popcnt8", r, queries, rank_popcnt8);
-    bench("popcnt_movdq", r, queries, rank_popcnt_movdq);
-    bench("popcnt_movdq2", r, queries, rank_popcnt_movdq2);
-    bench("popcnt_movdq4", r, queries, rank_popcnt_movdq4);
+    // the reference
+    const uint64_t expected = rank_popcnt(queries);
+
+    bool ok = true;
+    ok &= bench("shift", r, queries, expected, rank_shift);
+    ok &= bench("anderson14", r, queries, expected, rank_anderson14);
+    ok &= bench("anderson24", r, queries, expected, rank_anderson24);
+    ok &= bench("lut8", r, queries, expected, rank_lut8);
+    ok &= bench("lut16", r, queries, expected, rank_lut16);
+    ok &= bench("popcnt", r, queries, expected, rank_popcnt);
+    ok &= bench("popcnt2", r, queries, expected, rank_popcnt2);
+    ok &= bench("popcnt4", r, queries, expected, rank_popcnt4);
+    ok &= bench("popcnt8", r, queries, expected, rank_popcnt8);
+    ok &= bench("popcnt_movdq", r, queries, expected, rank_popcnt_movdq);
+    ok &= bench("popcnt_movdq2", r, queries, expected, rank_popcnt_movdq2);
+    ok &= bench("popcnt_movdq4", r, queries, expected, rank_popcnt_movdq4);
+
+    // library kernels - every one supported by the CPU, then the one selected
+    {
+        using namespace popcount_kernels;
+        auto run = [&](const std::string& name, auto count){
+            ok &= bench(name, r, queries, expected, [&](const std::vector<uint64_t>& a){
+                return count(a.data(), a.size());
+            });
+        };
+
+        run("kernel_scalar", count_scalar);
+        if(cpu::has_popcnt()) run("kernel_popcnt", count_popcnt);
+        if(cpu::has_avx2()) run("kernel_avx2", count_avx2);
+        if(cpu::has_avx512vpopcntdq()) run("kernel_avx512", count_avx512);
+    }
+
+    const std::string kernel = popcount_kernel();
+    ok &= bench("popcount[" + kernel + "]", r, queries, expected, rank_library);
+    ok &= bench("popcount_blocks[" + kernel + "]", r, queries, expected, rank_library_blocks);
+
+    // bit vector
+    {
+        bit_vector bv(queries.size() * 64ULL);
+        for(size_t i = 0; i < queries.size(); i++) {
+            for(uint64_t x = queries[i]; x; x &= x - 1) bv[i * 64ULL + __builtin_ctzll(x)] = 1;
+        }
+
+        ok &= bench("bit_vector[" + kernel + "]", r, queries, expected, [&](const std::vector<uint64_t>&){
+            return bv.popcount();
+        });
+
+        // a range not aligned to words, split into two parts
+        const size_t m = bv.size() / 3 + 7;
+        ok &= bench("bit_vector_range[" + kernel + "]", r, queries, expected, [&](const std::vector<uint64_t>&){
+            return bv.popcount(0, m) + bv.popcount(m, bv.size());
+        });
+    }
+
+    if(!ok) {
+        std::cerr << "popcount results differ!" << std::endl;
+        return -3;
+    }
     return 0;
 }
 
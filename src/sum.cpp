@@ -1,101 +1,256 @@
 #include <cstdint>
 #include <iostream>
+#include <thread>
 #include <vector>
 
-#include <immintrin.h>
-
 #include <stash/io/load_file.hpp>
 
 #include <stash/rapl/reader.hpp>
 #include <stash/rapl/power.hpp>
+#include <stash/util/cpu.hpp>
+#include <stash/util/parallel.hpp>
 #include <stash/util/time.hpp>
 
 #include <tlx/cmdline_parser.hpp>
 
 using namespace stash;
 
-uint64_t sum_for(const std::vector<uint64_t>& a) {
-    const size_t n = a.size();
+// a summation kernel for n words starting at a
+using sum_kernel_t = uint64_t (*)(const uint64_t* a, const size_t n);
+
+// plain loop, which the compiler may vectorize on its own
+uint64_t sum_for(const uint64_t* a, const size_t n) {
     uint64_t sum = 0;
-    for(size_t i = 0; i < a.size(); i++) {
+    for(size_t i = 0; i < n; i++) {
         sum += a[i];
     }
     return sum;
 }
 
-#ifdef __AVX512F__
-uint64_t sum_avx512(const std::vector<uint64_t>& a) {
-    const size_t n = a.size();
+// four independent scalar accumulators, not vectorized by the compiler
+__attribute__((optimize("no-tree-vectorize")))
+uint64_t sum_scalar4(const uint64_t* a, const size_t n) {
+    uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4) {
+        s0 += a[i];
+        s1 += a[i+1];
+        s2 += a[i+2];
+        s3 += a[i+3];
+    }
+    for(; i < n; i++) {
+        s0 += a[i];
+    }
+    return s0 + s1 + s2 + s3;
+}
 
+#ifdef STASH_X86
+// the SIMD kernels sum up to the first address aligned to their vector size
+// using scalar additions, then use aligned loads into four independent
+// accumulators, which are reduced horizontally only once at the end
+
+STASH_TARGET("sse2")
+uint64_t sum_sse(const uint64_t* a, const size_t n) {
     uint64_t sum = 0;
     size_t i = 0;
-    for(; i+8 < n; i += 8) {
-        auto v = _mm512_set_epi64(a[i], a[i+1], a[i+2], a[i+3], a[i+4], a[i+5], a[i+6], a[i+7]);
-        sum += _mm512_reduce_add_epi64(v);
+    for(; i < n && (uintptr_t(a + i) & 15ULL); i++) {
+        sum += a[i];
+    }
+
+    __m128i s0 = _mm_setzero_si128(), s1 = _mm_setzero_si128();
+    __m128i s2 = _mm_setzero_si128(), s3 = _mm_setzero_si128();
+    for(; i + 8 <= n; i += 8) {
+        s0 = _mm_add_epi64(s0, _mm_load_si128((const __m128i*)(a + i)));
+        s1 = _mm_add_epi64(s1, _mm_load_si128((const __m128i*)(a + i + 2)));
+        s2 = _mm_add_epi64(s2, _mm_load_si128((const __m128i*)(a + i + 4)));
+        s3 = _mm_add_epi64(s3, _mm_load_si128((const __m128i*)(a + i + 6)));
+    }
+
+    const __m128i s = _mm_add_epi64(_mm_add_epi64(s0, s1), _mm_add_epi64(s2, s3));
+    sum += uint64_t(_mm_cvtsi128_si64(s)) + uint64_t(_mm_cvtsi128_si64(_mm_unpackhi_epi64(s, s)));
+
+    for(; i < n; i++) {
+        sum += a[i];
+    }
+    return sum;
+}
+
+STASH_TARGET("avx2")
+uint64_t sum_avx2(const uint64_t* a, const size_t n) {
+    uint64_t sum = 0;
+    size_t i = 0;
+    for(; i < n && (uintptr_t(a + i) & 31ULL); i++) {
+        sum += a[i];
+    }
+
+    __m256i s0 = _mm256_setzero_si256(), s1 = _mm256_setzero_si256();
+    __m256i s2 = _mm256_setzero_si256(), s3 = _mm256_setzero_si256();
+    for(; i + 16 <= n; i += 16) {
+        s0 = _mm256_add_epi64(s0, _mm256_load_si256((const __m256i*)(a + i)));
+        s1 = _mm256_add_epi64(s1, _mm256_load_si256((const __m256i*)(a + i + 4)));
+        s2 = _mm256_add_epi64(s2, _mm256_load_si256((const __m256i*)(a + i + 8)));
+        s3 = _mm256_add_epi64(s3, _mm256_load_si256((const __m256i*)(a + i + 12)));
+    }
+
+    const __m256i s = _mm256_add_epi64(_mm256_add_epi64(s0, s1), _mm256_add_epi64(s2, s3));
+    const __m128i h = _mm_add_epi64(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1));
+    sum += uint64_t(_mm_cvtsi128_si64(h)) + uint64_t(_mm_extract_epi64(h, 1));
+
+    for(; i < n; i++) {
+        sum += a[i];
+    }
+    return sum;
+}
+
+STASH_SUPPRESS_UNINITIALIZED_BEGIN
+STASH_TARGET("avx512f")
+uint64_t sum_avx512(const uint64_t* a, const size_t n) {
+    uint64_t sum = 0;
+    size_t i = 0;
+    for(; i < n && (uintptr_t(a + i) & 63ULL); i++) {
+        sum += a[i];
+    }
+
+    __m512i s0 = _mm512_setzero_si512(), s1 = _mm512_setzero_si512();
+    __m512i s2 = _mm512_setzero_si512(), s3 = _mm512_setzero_si512();
+    for(; i + 32 <= n; i += 32) {
+        s0 = _mm512_add_epi64(s0, _mm512_load_si512(a + i));
+        s1 = _mm512_add_epi64(s1, _mm512_load_si512(a + i + 8));
+        s2 = _mm512_add_epi64(s2, _mm512_load_si512(a + i + 16));
+        s3 = _mm512_add_epi64(s3, _mm512_load_si512(a + i + 24));
     }
+    sum += _mm512_reduce_add_epi64(_mm512_add_epi64(_mm512_add_epi64(s0, s1), _mm512_add_epi64(s2, s3)));
+
     for(; i < n; i++) {
         sum += a[i];
     }
     return sum;
 }
+STASH_SUPPRESS_UNINITIALIZED_END
 #endif
 
+// the widest kernel supported by the CPU
+void select_kernel(std::string& name, sum_kernel_t& kernel) {
+    #ifdef STASH_X86
+    if(cpu::has_avx512f()) {
+        name = "avx512";
+        kernel = sum_avx512;
+        return;
+    }
+    if(cpu::has_avx2()) {
+        name = "avx2";
+        kernel = sum_avx2;
+        return;
+    }
+    name = "sse";
+    kernel = sum_sse;
+    #else
+    name = "scalar4";
+    kernel = sum_scalar4;
+    #endif
+}
+
+// thread-parallel reduction - every thread sums a slice using the given kernel
+uint64_t sum_parallel(const uint64_t* a, const size_t n, const size_t num_threads, sum_kernel_t kernel) {
+    // the partial sums are a cache line apart to avoid false sharing
+    std::vector<uint64_t> partial(num_threads * 8, 0);
+    parallel_for_pinned(n, num_threads, [&](const size_t t, const size_t begin, const size_t end){
+        partial[t * 8] = kernel(a + begin, end - begin);
+    });
+
+    uint64_t sum = 0;
+    for(size_t t = 0; t < num_threads; t++) {
+        sum += partial[t * 8];
+    }
+    return sum;
+}
+
 int main(int argc, char** argv) {
     tlx::CmdlineParser cp;
 
     std::string filename;
     cp.add_param_string("file", filename, "the input filename");
-    
+
+    size_t repeat = 1;
+    cp.add_size_t('r', "repeat", repeat, "The number of times each method sums the input (default: 1).");
+
+    size_t num_threads = std::max(std::thread::hardware_concurrency(), 1U);
+    cp.add_size_t('t', "threads", num_threads, "The number of threads for the parallel reduction (default: number of cores).");
+
     if (!cp.process(argc, argv)) {
         return -1;
     }
 
+    if(num_threads == 0) {
+        std::cerr << "the number of threads must be at least 1" << std::endl;
+        return -1;
+    }
+
     rapl::reader r;
     auto a = io::load_file_lines_as_vector<uint64_t>(filename);
+    const size_t n = a.size();
+    const size_t bytes = n * sizeof(uint64_t) * repeat;
 
-    // for
-    {
-        auto t0 = time();
-        auto e0 = r.read().total();
-        
-        auto sum = sum_for(a);
-
-        const auto t = time() - t0;
-        const auto e = r.read().total() - e0;
-        std::cout << "RESULT"
-                  << " method=for"
-                  << " time=" << t
-                  << " e.core=" << e.core
-                  << " e.uncore=" << e.uncore
-                  << " e.dram=" << e.dram
-                  << " sum=" << sum
-                  << std::endl;
-    }
+    const uint64_t expected = sum_for(a.data(), n);
+    bool ok = true;
 
-    // AVX512
-    #ifdef __AVX512F__
-    {
+    // runs f repeat times and reports time and energy
+    auto measure = [&](const std::string& method, const size_t threads, auto f){
         auto t0 = time();
         auto e0 = r.read().total();
-        
-        auto sum = sum_avx512(a);
+
+        uint64_t sum = 0;
+        for(size_t i = 0; i < repeat; i++) {
+            // keep the compiler from summing only once for all repetitions
+            __asm__ volatile("" : : : "memory");
+            sum = f();
+        }
 
         const auto t = time() - t0;
         const auto e = r.read().total() - e0;
         const auto p = rapl::power(e, t);
+        const double gb = double(bytes) / 1e9;
         std::cout << "RESULT"
-                  << " method=avx512"
+                  << " method=" << method
+                  << " threads=" << threads
+                  << " bytes=" << bytes
                   << " time=" << t
+                  << " e.package=" << e.package
                   << " e.core=" << e.core
                   << " e.uncore=" << e.uncore
                   << " e.dram=" << e.dram
                   << " p.core=" << p.core
                   << " p.uncore=" << p.uncore
                   << " p.dram=" << p.dram
+                  << " epgb.package=" << double(e.package) / gb
+                  << " epgb.dram=" << double(e.dram) / gb
                   << " sum=" << sum
+                  << " check=" << (sum == expected ? "ok" : "FAIL")
                   << std::endl;
+        ok &= (sum == expected);
+    };
+
+    measure("for", 1, [&](){ return sum_for(a.data(), n); });
+    measure("scalar4", 1, [&](){ return sum_scalar4(a.data(), n); });
+
+    // SIMD kernels supported by the CPU
+    #ifdef STASH_X86
+    measure("sse", 1, [&](){ return sum_sse(a.data(), n); });
+    if(cpu::has_avx2()) {
+        measure("avx2", 1, [&](){ return sum_avx2(a.data(), n); });
+    }
+    if(cpu::has_avx512f()) {
+        measure("avx512", 1, [&](){ return sum_avx512(a.data(), n); });
     }
     #endif
 
-    return 0;
+    // thread-parallel reduction using the best kernel
+    {
+        std::string name;
+        sum_kernel_t kernel;
+        select_kernel(name, kernel);
+        measure("parallel-" + name, num_threads, [&](){ return sum_parallel(a.data(), n, num_threads, kernel); });
+    }
+
+    return ok ? 0 : -2;
 }
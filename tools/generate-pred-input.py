@@ -0,0 +1,34 @@
+#!/usr/bin/python3
+
+# generates a sorted sequence of distinct 40-bit integers
+# in the input format of the pred benchmark
+
+import argparse
+import random
+
+parser = argparse.ArgumentParser(description='generate input for the pred benchmark')
+parser.add_argument('output')
+parser.add_argument('-n', '--num', type=int, default=10000000, help='the number of values to draw (duplicates are removed)')
+parser.add_argument('-u', '--universe', type=int, default=1 << 40, help='the universe to draw values from')
+parser.add_argument('-d', '--dist', choices=['uniform', 'skewed'], default='uniform')
+parser.add_argument('-e', '--exponent', type=float, default=4.0, help='the skew exponent, larger values concentrate the values near zero')
+parser.add_argument('-s', '--seed', type=int, default=0)
+args = parser.parse_args()
+
+if args.universe > (1 << 40):
+    parser.error('the universe must not exceed 2^40')
+
+random.seed(args.seed)
+
+if args.dist == 'uniform':
+    draw = lambda: random.randrange(args.universe)
+else:
+    # power law: most values are small, but some span the whole universe
+    draw = lambda: int(args.universe * (random.random() ** args.exponent))
+
+values = sorted(set(draw() for _ in range(args.num)))
+
+with open(args.output, 'wb') as f:
+    f.write(b''.join(x.to_bytes(5, 'little') for x in values))
+
+print(f'{len(values)} values written to {args.output}')